@@ -0,0 +1,13 @@
+/*
+ * Copyright (C) 2025 Matej Bölcskei, ETH Zurich
+ * Licensed under the GNU General Public License as published by the Free Software Foundation, version 3.
+ * See LICENSE or <https://www.gnu.org/licenses/gpl-3.0.html> for details.
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+// The module's view of the rubench ioctl ABI. The definitions live in the
+// library header so the two cannot drift apart.
+#include "../../src/rubench.hpp"
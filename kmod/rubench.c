@@ -10,9 +10,16 @@
 
 #include <asm/io.h>
 #include <linux/cpu.h>
+#include <linux/delay.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
 #include <linux/mm.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <linux/version.h>
+#include <linux/wait.h>
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 15, 0) && \
     LINUX_VERSION_CODE < KERNEL_VERSION(5, 16, 0)
@@ -60,6 +67,195 @@ static const struct file_operations rubench_fops = {
     .unlocked_ioctl = rubench_ioctl,
 };
 
+static struct zone *rubench_zone(int nid, int zid) {
+  struct zone *zone;
+
+  if (zid == RUBENCH_ZONE_NORMAL) {
+    zid = ZONE_NORMAL;
+  }
+  if (nid < 0 || nid >= MAX_NUMNODES || !node_online(nid)) {
+    return NULL;
+  }
+  if (zid < 0 || zid >= MAX_NR_ZONES) {
+    return NULL;
+  }
+
+  zone = &NODE_DATA(nid)->node_zones[zid];
+  if (!populated_zone(zone)) {
+    return NULL;
+  }
+  return zone;
+}
+
+/*
+ * Same as get_pageblock_migratetype(), which modules cannot use because
+ * get_pfnblock_flags_mask() is not exported. Reads the SPARSEMEM usemap
+ * directly, like __get_pfnblock_flags_mask() does.
+ */
+static unsigned char rubench_pageblock_migratetype(unsigned long pfn) {
+  struct mem_section *ms;
+  unsigned long *bitmap;
+  unsigned long bitidx;
+  unsigned long word;
+
+  if (!pfn_valid(pfn)) {
+    return RUBENCH_MIGRATE_INVALID;
+  }
+
+  ms = __pfn_to_section(pfn);
+  bitmap = section_to_usemap(ms);
+  bitidx = ((pfn & (PAGES_PER_SECTION - 1)) >> pageblock_order) *
+           NR_PAGEBLOCK_BITS;
+  word = READ_ONCE(bitmap[BIT_WORD(bitidx)]);
+  bitidx &= (BITS_PER_LONG - 1);
+
+  return (word >> bitidx) & MIGRATETYPE_MASK;
+}
+
+/*
+ * Physical-address watchpoints. A kthread polls the armed PAs and logs
+ * every value change with a timestamp into a bounded buffer that user
+ * space drains with RUBENCH_WATCH_READ. Periods below
+ * RUBENCH_WATCH_SPIN_NS are busy-waited for microsecond resolution.
+ * RUBENCH_WATCH_PERIOD switches a sleeping poller to spinning (or back)
+ * without restarting the thread, so it can be done from a window in
+ * which the caller must not allocate.
+ */
+#define RUBENCH_WATCH_SPIN_NS 20000UL
+
+struct rubench_watch {
+  unsigned long pa[RUBENCH_MAX_WATCHES];
+  unsigned long last[RUBENCH_MAX_WATCHES];
+  unsigned long nr;
+  unsigned long period_ns;
+  struct task_struct *thread;
+  wait_queue_head_t wq; /* cuts a sleep short on a period change */
+
+  spinlock_t lock; /* protects the event ring below */
+  struct rubench_watch_event events[RUBENCH_WATCH_EVENTS];
+  unsigned long head;
+  unsigned long count;
+  unsigned long dropped;
+};
+
+static struct rubench_watch rubench_watch = {
+    .lock = __SPIN_LOCK_UNLOCKED(rubench_watch.lock),
+    .wq = __WAIT_QUEUE_HEAD_INITIALIZER(rubench_watch.wq),
+};
+static DEFINE_MUTEX(rubench_watch_mutex); /* serialises arm/disarm */
+
+static unsigned long rubench_watch_load(unsigned long pa) {
+  return READ_ONCE(*(unsigned long *)phys_to_virt(pa));
+}
+
+static void rubench_watch_record(struct rubench_watch *w, unsigned long i,
+                                 unsigned long value) {
+  struct rubench_watch_event *ev;
+
+  spin_lock(&w->lock);
+  if (w->count == RUBENCH_WATCH_EVENTS) {
+    w->dropped++;
+  } else {
+    ev = &w->events[(w->head + w->count) % RUBENCH_WATCH_EVENTS];
+    ev->pa = w->pa[i];
+    ev->old_value = w->last[i];
+    ev->new_value = value;
+    ev->ktime_ns = ktime_get_ns();
+    ev->cpu = raw_smp_processor_id();
+    w->count++;
+  }
+  spin_unlock(&w->lock);
+
+  w->last[i] = value;
+}
+
+static int rubench_watch_fn(void *arg) {
+  struct rubench_watch *w = arg;
+  unsigned long i;
+  unsigned long value;
+  unsigned long period;
+  u64 deadline;
+
+  while (!kthread_should_stop()) {
+    period = READ_ONCE(w->period_ns);
+    deadline = ktime_get_ns() + period;
+
+    for (i = 0; i < w->nr; i++) {
+      value = rubench_watch_load(w->pa[i]);
+      if (value != w->last[i]) {
+        rubench_watch_record(w, i, value);
+      }
+    }
+
+    if (period >= RUBENCH_WATCH_SPIN_NS) {
+      wait_event_interruptible_hrtimeout(
+          w->wq,
+          READ_ONCE(w->period_ns) != period || kthread_should_stop(),
+          ns_to_ktime(period));
+    } else {
+      while (ktime_get_ns() < deadline && !kthread_should_stop()) {
+        cpu_relax();
+      }
+      cond_resched();
+    }
+  }
+
+  return 0;
+}
+
+static void rubench_watch_stop(struct rubench_watch *w) {
+  if (w->thread) {
+    kthread_stop(w->thread);
+    w->thread = NULL;
+  }
+}
+
+static int rubench_watch_start(struct rubench_watch *w,
+                               const struct rubench_watch_arm_data *data) {
+  struct task_struct *thread;
+  unsigned long i;
+
+  if (data->nr == 0 || data->nr > RUBENCH_MAX_WATCHES) {
+    return -EINVAL;
+  }
+  if (data->cpu >= 0 &&
+      (data->cpu >= nr_cpu_ids || !cpu_online(data->cpu))) {
+    return -EINVAL;
+  }
+  for (i = 0; i < data->nr; i++) {
+    if (!IS_ALIGNED(data->pa[i], sizeof(unsigned long)) ||
+        !pfn_valid(PHYS_PFN(data->pa[i]))) {
+      return -EINVAL;
+    }
+  }
+
+  rubench_watch_stop(w);
+
+  for (i = 0; i < data->nr; i++) {
+    w->pa[i] = data->pa[i];
+    w->last[i] = rubench_watch_load(data->pa[i]);
+  }
+  w->nr = data->nr;
+  w->period_ns = data->period_ns;
+
+  spin_lock(&w->lock);
+  w->head = 0;
+  w->count = 0;
+  w->dropped = 0;
+  spin_unlock(&w->lock);
+
+  thread = kthread_create(rubench_watch_fn, w, "rubench_watch");
+  if (IS_ERR(thread)) {
+    return PTR_ERR(thread);
+  }
+  if (data->cpu >= 0) {
+    kthread_bind(thread, data->cpu);
+  }
+  w->thread = thread;
+  wake_up_process(thread);
+  return 0;
+}
+
 static int rubench_major;
 static struct class *rubench_class;
 static struct device *rubench_device;
@@ -70,6 +266,10 @@ static int rubench_open(struct inode *inode, struct file *file) {
 }
 
 static int rubench_release(struct inode *inode, struct file *file) {
+  mutex_lock(&rubench_watch_mutex);
+  rubench_watch_stop(&rubench_watch);
+  mutex_unlock(&rubench_watch_mutex);
+
   pr_info("Rubench module released\n");
   return 0;
 }
@@ -87,7 +287,14 @@ static long rubench_ioctl(struct file *file, unsigned int cmd,
       int count;
       struct page *page, *next;
 
-      zone = &NODE_DATA(0)->node_zones[ZONE_NORMAL];
+      if (copy_from_user(&data, (void __user *)arg, sizeof(data))) {
+        return -EFAULT;
+      }
+
+      zone = rubench_zone(data.node, data.zone);
+      if (!zone) {
+        return -EINVAL;
+      }
       cpu = get_cpu();
       pcp = per_cpu_ptr(zone->per_cpu_pageset, cpu);
 
@@ -112,8 +319,8 @@ static long rubench_ioctl(struct file *file, unsigned int cmd,
         return -EFAULT;
       }
 
-      get_user_pages_fast((unsigned long)data.va, 1, 0, &page);
-      if (!page) {
+      /* Never faults: a non-present page is reported, not populated. */
+      if (!get_user_page_fast_only((unsigned long)data.va, 0, &page)) {
         return -EFAULT;
       }
       data.pa = page_to_phys(page);
@@ -144,6 +351,122 @@ static long rubench_ioctl(struct file *file, unsigned int cmd,
       break;
     }
 
+    case RUBENCH_GET_MIGRATETYPES: {
+      struct rubench_migratetypes_data data;
+      unsigned char __user *types;
+      unsigned long pfn;
+      unsigned long i;
+
+      if (copy_from_user(&data, (void __user *)arg, sizeof(data))) {
+        return -EFAULT;
+      }
+      if (data.nr_blocks == 0 || data.nr_blocks > RUBENCH_MAX_PAGEBLOCKS) {
+        return -EINVAL;
+      }
+
+      /*
+       * Samples are taken while the test waits for a specific page on the
+       * PCP list, so this path must not allocate: write the user buffer
+       * directly instead of staging it in a kmalloc'd copy.
+       */
+      types = (unsigned char __user *)data.types;
+      pfn = ALIGN_DOWN(data.start_pfn, pageblock_nr_pages);
+      for (i = 0; i < data.nr_blocks; i++, pfn += pageblock_nr_pages) {
+        if (put_user(rubench_pageblock_migratetype(pfn), types + i)) {
+          return -EFAULT;
+        }
+      }
+
+      data.start_pfn = ALIGN_DOWN(data.start_pfn, pageblock_nr_pages);
+      data.pageblock_pages = pageblock_nr_pages;
+      if (copy_to_user((void __user *)arg, &data, sizeof(data))) {
+        return -EFAULT;
+      }
+      break;
+    }
+
+    case RUBENCH_WATCH_ARM: {
+      struct rubench_watch_arm_data data;
+      int ret;
+
+      if (copy_from_user(&data, (void __user *)arg, sizeof(data))) {
+        return -EFAULT;
+      }
+
+      mutex_lock(&rubench_watch_mutex);
+      ret = rubench_watch_start(&rubench_watch, &data);
+      mutex_unlock(&rubench_watch_mutex);
+      if (ret) {
+        return ret;
+      }
+      break;
+    }
+
+    case RUBENCH_WATCH_READ: {
+      struct rubench_watch_read_data data;
+      struct rubench_watch *w = &rubench_watch;
+      struct rubench_watch_event *events;
+      unsigned long i;
+
+      if (copy_from_user(&data, (void __user *)arg, sizeof(data))) {
+        return -EFAULT;
+      }
+      data.max = min_t(unsigned long, data.max, RUBENCH_WATCH_EVENTS);
+
+      events = kmalloc_array(max(data.max, 1UL), sizeof(*events), GFP_KERNEL);
+      if (!events) {
+        return -ENOMEM;
+      }
+
+      spin_lock(&w->lock);
+      data.nr = min(data.max, w->count);
+      for (i = 0; i < data.nr; i++) {
+        events[i] = w->events[(w->head + i) % RUBENCH_WATCH_EVENTS];
+      }
+      w->head = (w->head + data.nr) % RUBENCH_WATCH_EVENTS;
+      w->count -= data.nr;
+      data.dropped = w->dropped;
+      spin_unlock(&w->lock);
+
+      if (copy_to_user((void __user *)data.events, events,
+                       data.nr * sizeof(*events)) ||
+          copy_to_user((void __user *)arg, &data, sizeof(data))) {
+        kfree(events);
+        return -EFAULT;
+      }
+
+      kfree(events);
+      break;
+    }
+
+    case RUBENCH_WATCH_PERIOD: {
+      unsigned long period_ns;
+      int ret = 0;
+
+      if (get_user(period_ns, (unsigned long __user *)arg)) {
+        return -EFAULT;
+      }
+
+      mutex_lock(&rubench_watch_mutex);
+      if (rubench_watch.thread) {
+        WRITE_ONCE(rubench_watch.period_ns, period_ns);
+        wake_up(&rubench_watch.wq);
+      } else {
+        ret = -ENOENT;
+      }
+      mutex_unlock(&rubench_watch_mutex);
+      if (ret) {
+        return ret;
+      }
+      break;
+    }
+
+    case RUBENCH_WATCH_DISARM:
+      mutex_lock(&rubench_watch_mutex);
+      rubench_watch_stop(&rubench_watch);
+      mutex_unlock(&rubench_watch_mutex);
+      break;
+
     default:
       return -ENOTTY;
   }
@@ -183,6 +506,10 @@ static int __init rubench_init(void) {
 }
 
 static void __exit rubench_exit(void) {
+  mutex_lock(&rubench_watch_mutex);
+  rubench_watch_stop(&rubench_watch);
+  mutex_unlock(&rubench_watch_mutex);
+
   device_destroy(rubench_class, MKDEV(rubench_major, 0));
   class_destroy(rubench_class);
   unregister_chrdev(rubench_major, DEVICE_NAME);
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2025 Matej Bölcskei, ETH Zurich
+ * Licensed under the GNU General Public License as published by the Free Software Foundation, version 3.
+ * See LICENSE or <https://www.gnu.org/licenses/gpl-3.0.html> for details.
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+// Round latency and success of install_round() under background allocator
+// noise.
+//
+//   bench_noise [levels] [rounds] [node] [seed] [config]
+//
+// levels is a comma-separated list of per-CPU noise rates in ops/s
+// (default 0,1000,10000,100000). The benchmark pins itself to the CPU it
+// starts on and runs one noise worker on every other allowed CPU.
+
+#include "noise.hpp"
+#include "rubench.hpp"
+#include "rubicon.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sched.h>
+#include <vector>
+
+static void* const kBlockBase = (void*)0x100000000UL;
+static void* const kSprayBase = (void*)0x200000000UL;
+
+static std::vector<double> parse_levels(const char* arg) {
+    std::vector<double> levels;
+    for(const char* p = arg; *p;) {
+        char* end;
+        levels.push_back(std::strtod(p, &end));
+        p = *end == ',' ? end + 1 : end + strlen(end);
+    }
+    return levels;
+}
+
+int main(int argc, char** argv) {
+    auto levels = parse_levels(argc > 1 ? argv[1] : "0,1000,10000,100000");
+    const int rounds = std::max(1, argc > 2 ? std::atoi(argv[2]) : 20);
+    set_target_node(argc > 3 ? std::atoi(argv[3]) : 0);
+    const uint64_t seed = argc > 4 ? std::strtoull(argv[4], nullptr, 0) : 0;
+    if(argc > 5) {
+        set_rubicon_config(load_config(argv[5]));
+    }
+
+    const int bench_cpu = sched_getcpu();
+    NoiseConfig noise;
+    noise.cpus = online_cpus_except(bench_cpu);
+    noise.seed = seed;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(bench_cpu, &set);
+    sched_setaffinity(0, sizeof(set), &set);
+
+    rubench_open();
+    SprayPool spray(kSprayBase, rubicon_config().spray_cover_bytes);
+
+    printf("%12s %8s %8s %14s %14s %14s %14s\n", "noise/cpu", "rounds",
+           "success", "mean ns", "p50 ns", "p99 ns", "noise ops/s");
+
+    for(double level : levels) {
+        noise.ops_per_sec = level;
+        NoiseGenerator gen(noise);
+
+        std::vector<long long> times;
+        int successes = 0;
+
+        gen.start();
+        const long long start = monotonic_ns();
+        for(int r = 0; r < rounds; ++r) {
+            const long long t = monotonic_ns();
+            successes += install_round(spray, kBlockBase);
+            times.push_back(monotonic_ns() - t);
+        }
+        const long long elapsed = monotonic_ns() - start;
+        gen.stop();
+
+        std::sort(times.begin(), times.end());
+        long long total = 0;
+        for(long long t : times) {
+            total += t;
+        }
+
+        printf("%12.0f %8d %7.1f%% %14lld %14lld %14lld %14.0f\n", level,
+               rounds, 100.0 * successes / rounds, total / rounds,
+               times[times.size() / 2], times[times.size() * 99 / 100],
+               gen.ops() / (elapsed * 1e-9));
+    }
+
+    rubench_close();
+    return 0;
+}
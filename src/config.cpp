@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2025 Matej Bölcskei, ETH Zurich
+ * Licensed under the GNU General Public License as published by the Free Software Foundation, version 3.
+ * See LICENSE or <https://www.gnu.org/licenses/gpl-3.0.html> for details.
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include "rubicon.hpp"
+
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+static RubiconConfig g_config;
+
+const std::vector<ConfigField>& config_fields() {
+    static const std::vector<ConfigField> fields = {
+        { "spray_cover_bytes", &RubiconConfig::spray_cover_bytes },
+        { "bait_count", &RubiconConfig::bait_count },
+        { "sample_pages", &RubiconConfig::sample_pages },
+        { "pcp_push_size", &RubiconConfig::pcp_push_size },
+        { "zone_reserve", &RubiconConfig::zone_reserve },
+        { "exhaust_margin", &RubiconConfig::exhaust_margin },
+    };
+    return fields;
+}
+
+const RubiconConfig& rubicon_config() noexcept {
+    return g_config;
+}
+
+void set_rubicon_config(const RubiconConfig& cfg) {
+    const std::size_t block_pages = 2 * kPageBlockSize / PAGE_SIZE;
+
+    if(cfg.spray_cover_bytes == 0) {
+        throw std::invalid_argument("spray_cover_bytes must be non-zero");
+    }
+
+    if(cfg.bait_count == 0 || cfg.bait_count > block_pages) {
+        throw std::invalid_argument("bait_count must be in [1, block pages]");
+    }
+
+    // pt_target and the file page are the first two samples.
+    if(cfg.sample_pages < 2 || cfg.sample_pages > block_pages) {
+        throw std::invalid_argument("sample_pages must be in [2, block pages]");
+    }
+
+    if(cfg.pcp_push_size == 0 || cfg.pcp_push_size % PAGE_SIZE != 0) {
+        throw std::invalid_argument(
+            "pcp_push_size must be a non-zero multiple of PAGE_SIZE");
+    }
+
+    if(cfg.zone_reserve < kMinReserve || cfg.exhaust_margin < kMinReserve) {
+        throw std::invalid_argument(
+            "zone_reserve and exhaust_margin must be at least 64 MiB");
+    }
+
+    // Both are subtracted from the node's free memory; a reserve the node
+    // cannot hold leaves nothing to drain or exhaust.
+    const std::size_t node_bytes = node_total_bytes(target_node());
+    if(cfg.zone_reserve >= node_bytes) {
+        throw std::invalid_argument(
+            "zone_reserve must be smaller than the target node's memory");
+    }
+
+    if(cfg.exhaust_margin >= node_bytes) {
+        throw std::invalid_argument(
+            "exhaust_margin must be smaller than the target node's memory");
+    }
+
+    g_config = cfg;
+}
+
+RubiconConfig load_config(const char* path) {
+    FILE* in = fopen(path, "r");
+    if(!in) {
+        throw std::system_error(errno, std::system_category(), path);
+    }
+
+    RubiconConfig cfg;
+    char line[256];
+    for(unsigned lineno = 1; fgets(line, sizeof(line), in); ++lineno) {
+        const std::string where =
+            std::string(path) + ":" + std::to_string(lineno) + ": ";
+
+        line[strcspn(line, "#\n")] = '\0';
+
+        char* p = line;
+        while(isspace((unsigned char)*p)) {
+            ++p;
+        }
+        if(*p == '\0') {
+            continue;
+        }
+
+        // name = value, with nothing but blanks after the value.
+        const char* name = p;
+        while(*p && *p != '=' && !isspace((unsigned char)*p)) {
+            ++p;
+        }
+        const std::string key(name, p - name);
+        while(isspace((unsigned char)*p)) {
+            ++p;
+        }
+
+        char* end = nullptr;
+        unsigned long long value = 0;
+        if(*p == '=') {
+            ++p;
+            while(isspace((unsigned char)*p)) {
+                ++p;
+            }
+            errno = 0;
+            value = *p == '-' ? 0 : strtoull(p, &end, 0);
+        }
+
+        if(!end || end == p || errno == ERANGE) {
+            fclose(in);
+            throw std::invalid_argument(where + "expected \"name = value\"");
+        }
+        while(isspace((unsigned char)*end)) {
+            ++end;
+        }
+        if(*end != '\0') {
+            fclose(in);
+            throw std::invalid_argument(where + "trailing text after value: " +
+                                        end);
+        }
+
+        bool known = false;
+        for(const auto& field : config_fields()) {
+            if(key == field.name) {
+                cfg.*field.member = value;
+                known             = true;
+            }
+        }
+
+        if(!known) {
+            fclose(in);
+            throw std::invalid_argument(where + "unknown config key: " + key);
+        }
+    }
+
+    fclose(in);
+    return cfg;
+}
+
+void write_config(FILE* out, const RubiconConfig& cfg) {
+    for(const auto& field : config_fields()) {
+        fprintf(out, "%s = %zu\n", field.name, cfg.*field.member);
+    }
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2025 Matej Bölcskei, ETH Zurich
+ * Licensed under the GNU General Public License as published by the Free Software Foundation, version 3.
+ * See LICENSE or <https://www.gnu.org/licenses/gpl-3.0.html> for details.
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include "migratetype.hpp"
+#include "rubench.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+MigratetypeTracker::MigratetypeTracker(unsigned long pfn,
+                                       std::size_t nr_blocks)
+    : pfn_(pfn), types_(nr_blocks), current_(nr_blocks) {
+    if(nr_blocks == 0 || nr_blocks > RUBENCH_MAX_PAGEBLOCKS) {
+        throw std::invalid_argument(
+            "MigratetypeTracker: pageblock count out of range");
+    }
+    changes_.reserve(kReservedChanges);
+
+    reset();
+    // The module reports the pageblock-aligned start.
+    pfn_ -= pfn_ % pageblock_pages_;
+}
+
+void MigratetypeTracker::query() {
+    pageblock_pages_ =
+        rubench_get_migratetypes(pfn_, current_.size(), current_.data());
+}
+
+void MigratetypeTracker::reset() {
+    query();
+    types_.swap(current_);
+    start_ns_ = monotonic_ns();
+    last_ns_  = start_ns_;
+    changes_.clear();
+}
+
+std::size_t MigratetypeTracker::sample(const char* stage) {
+    query();
+    const long long t = monotonic_ns();
+    std::size_t found = 0;
+
+    for(std::size_t i = 0; i < current_.size(); ++i) {
+        if(current_[i] == types_[i]) {
+            continue;
+        }
+
+        changes_.push_back({ pfn_ + i * pageblock_pages_, types_[i],
+                             current_[i], stage, t - start_ns_,
+                             t - last_ns_ });
+        ++found;
+    }
+
+    types_.swap(current_);
+    last_ns_ = t;
+    return found;
+}
+
+const char* migratetype_name(unsigned char type) noexcept {
+    // enum migratetype order shared by the supported kernels; CMA and
+    // ISOLATE shift with the config, so they are not named here.
+    switch(type) {
+    case 0: return "unmovable";
+    case 1: return "movable";
+    case 2: return "reclaimable";
+    case 3: return "highatomic";
+    case RUBENCH_MIGRATE_INVALID: return "invalid";
+    default: return "other";
+    }
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2025 Matej Bölcskei, ETH Zurich
+ * Licensed under the GNU General Public License as published by the Free Software Foundation, version 3.
+ * See LICENSE or <https://www.gnu.org/licenses/gpl-3.0.html> for details.
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// A pageblock whose migratetype differed between two samples.
+struct MigratetypeChange {
+    unsigned long pfn;        // first PFN of the pageblock
+    unsigned char from;
+    unsigned char to;
+    const char* stage;        // label of the sample that observed it
+    long long since_start_ns; // from reset() to the observing sample
+    long long window_ns;      // from the previous sample, i.e. the
+                              // interval the change happened in
+};
+
+// Samples the migratetype of a range of pageblocks through the rubench
+// module (one ioctl per sample) and records every transition. Samples reuse
+// preallocated buffers, so they only allocate to grow changes() beyond
+// kReservedChanges.
+class MigratetypeTracker {
+public:
+    static constexpr std::size_t kReservedChanges = 64;
+
+    MigratetypeTracker(unsigned long pfn, std::size_t nr_blocks);
+
+    // Takes a new baseline and restarts the clock; keeps no history.
+    void reset();
+    // Diffs against the previous sample; returns the number of changes.
+    std::size_t sample(const char* stage);
+
+    unsigned long start_pfn() const noexcept {
+        return pfn_;
+    }
+    unsigned long pageblock_pages() const noexcept {
+        return pageblock_pages_;
+    }
+    const std::vector<unsigned char>& types() const noexcept {
+        return types_;
+    }
+    const std::vector<MigratetypeChange>& changes() const noexcept {
+        return changes_;
+    }
+
+private:
+    // Fills current_; never allocates.
+    void query();
+
+    unsigned long pfn_;
+    unsigned long pageblock_pages_ = 0;
+    std::vector<unsigned char> types_;
+    std::vector<unsigned char> current_;
+    std::vector<MigratetypeChange> changes_;
+    long long start_ns_ = 0;
+    long long last_ns_  = 0;
+};
+
+const char* migratetype_name(unsigned char type) noexcept;
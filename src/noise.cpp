@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 2025 Matej Bölcskei, ETH Zurich
+ * Licensed under the GNU General Public License as published by the Free Software Foundation, version 3.
+ * See LICENSE or <https://www.gnu.org/licenses/gpl-3.0.html> for details.
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include "noise.hpp"
+#include "rubicon.hpp"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <pthread.h>
+#include <random>
+#include <sched.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <system_error>
+#include <time.h>
+#include <unistd.h>
+#include <utility>
+
+// Size of each worker's page-cache file
+static constexpr std::size_t kCacheFileSize = 16UL << 20;
+
+// PAGE_ALLOC_COSTLY_ORDER: the largest fragment af_unix asks for.
+static constexpr unsigned kMaxSocketOrder = 3;
+
+// Linear part of a socket datagram. af_unix keeps up to SKB_MAX_ALLOC
+// (16 KiB minus the skb_shared_info) in one kmalloc'd order-2 buffer and
+// puts the rest in page fragments; staying 1 KiB below it makes the rest
+// round up to exactly the requested fragment size.
+static constexpr std::size_t kSocketLinear = (PAGE_SIZE << 2) - 1024;
+
+namespace {
+
+enum class NoiseKind { Anon, Thp, Socket, Cache, PageTable };
+
+// One live allocation owned by a worker.
+struct Held {
+    NoiseKind kind;
+    void* addr;       // anon/THP/page-table mappings
+    std::size_t len;  // mapping length, or file offset for Cache
+    int sock[2];      // socketpair holding the datagram for Socket
+};
+
+void release(const Held& h, int fd) {
+    switch(h.kind) {
+    case NoiseKind::Anon:
+    case NoiseKind::Thp:
+    case NoiseKind::PageTable: munmap(h.addr, h.len); break;
+    case NoiseKind::Socket:
+        // Closing the receiver frees the queued skb and its pages.
+        close(h.sock[0]);
+        close(h.sock[1]);
+        break;
+    case NoiseKind::Cache:
+        fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, h.len,
+                  PAGE_SIZE);
+        break;
+    }
+}
+
+// Fills `out` and returns true on success; failed attempts hold nothing.
+bool acquire(NoiseKind kind, std::mt19937_64& rng, unsigned max_order,
+             int fd, Held& out) {
+    switch(kind) {
+    case NoiseKind::Anon: {
+        void* p = mmap(nullptr, PAGE_SIZE, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(p == MAP_FAILED) {
+            return false;
+        }
+        *static_cast<volatile char*>(p) = 1;
+        out = { kind, p, PAGE_SIZE, {} };
+        return true;
+    }
+
+    case NoiseKind::Thp: {
+        // Twice the size so one aligned 2 MiB range is inside.
+        const std::size_t len = 2 * kPageBlockSize;
+        void* p = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if(p == MAP_FAILED) {
+            return false;
+        }
+        const auto huge = (reinterpret_cast<uintptr_t>(p) +
+                           kPageBlockSize - 1) & ~(kPageBlockSize - 1);
+        madvise(reinterpret_cast<void*>(huge), kPageBlockSize,
+                MADV_HUGEPAGE);
+        *reinterpret_cast<volatile char*>(huge) = 1;
+        out = { kind, p, len, {} };
+        return true;
+    }
+
+    case NoiseKind::Socket: {
+        Held h{ kind, nullptr, 0, { -1, -1 } };
+        if(socketpair(AF_UNIX, SOCK_DGRAM, 0, h.sock) != 0) {
+            return false;
+        }
+
+        const unsigned order  = 1 + rng() % max_order;
+        const std::size_t len = kSocketLinear + (PAGE_SIZE << order);
+        static const char
+            msg[kSocketLinear + (PAGE_SIZE << kMaxSocketOrder)] = { 1 };
+        if(send(h.sock[1], msg, len, MSG_DONTWAIT) != (ssize_t)len) {
+            release(h, fd);
+            return false;
+        }
+        out = h;
+        return true;
+    }
+
+    case NoiseKind::Cache: {
+        const std::size_t off = (rng() % (kCacheFileSize / PAGE_SIZE)) *
+            PAGE_SIZE;
+        static const char page[PAGE_SIZE] = { 1 };
+        if(pwrite(fd, page, PAGE_SIZE, off) != (ssize_t)PAGE_SIZE) {
+            return false;
+        }
+        out = { kind, nullptr, off, {} };
+        return true;
+    }
+
+    case NoiseKind::PageTable: {
+        // Two spans so one of them is fully covered and gets its own
+        // page table, freed again by the munmap.
+        const std::size_t len = 2 * kX86_64PageTableSpan;
+        void* p = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if(p == MAP_FAILED) {
+            return false;
+        }
+        madvise(p, len, MADV_NOHUGEPAGE);
+        const auto span = (reinterpret_cast<uintptr_t>(p) +
+                           kX86_64PageTableSpan - 1) &
+            ~(kX86_64PageTableSpan - 1);
+        *reinterpret_cast<volatile char*>(span) = 1;
+        out = { kind, p, len, {} };
+        return true;
+    }
+    }
+
+    return false;
+}
+
+} // namespace
+
+NoiseGenerator::NoiseGenerator(NoiseConfig cfg) : cfg_(std::move(cfg)) {
+    if(cfg_.ops_per_sec < 0) {
+        throw std::invalid_argument("NoiseGenerator: negative rate");
+    }
+
+    if(cfg_.anon_weight + cfg_.thp_weight + cfg_.socket_weight +
+       cfg_.cache_weight + cfg_.ptable_weight == 0) {
+        throw std::invalid_argument("NoiseGenerator: all weights are zero");
+    }
+
+    if(cfg_.max_order == 0 || cfg_.max_order > kMaxSocketOrder) {
+        throw std::invalid_argument("NoiseGenerator: max_order must be in "
+                                    "[1, 3]");
+    }
+
+    if(cfg_.node >= static_cast<int>(NodeBinding::kMaxNodes)) {
+        throw std::invalid_argument("NoiseGenerator: node out of range");
+    }
+}
+
+NoiseGenerator::~NoiseGenerator() {
+    stop();
+}
+
+void NoiseGenerator::start() {
+    if(running_ || cfg_.ops_per_sec == 0) {
+        return;
+    }
+
+    // Bind once here so a bad node throws to the caller instead of
+    // terminating the process from inside a worker thread.
+    node_ = cfg_.node >= 0 ? cfg_.node : target_node();
+    { NodeBinding check(node_); }
+
+    running_ = true;
+
+    for(std::size_t i = 0; i < cfg_.cpus.size(); ++i) {
+        workers_.emplace_back(&NoiseGenerator::worker, this, i);
+    }
+}
+
+void NoiseGenerator::stop() {
+    running_ = false;
+    for(auto& t : workers_) {
+        t.join();
+    }
+    workers_.clear();
+}
+
+void NoiseGenerator::worker(std::size_t index) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cfg_.cpus[index], &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+    // The policy is per thread; without it the noise lands on whichever
+    // node the worker's CPU belongs to instead of the one under test.
+    NodeBinding bind(node_);
+
+    std::mt19937_64 rng(cfg_.seed + index);
+    std::discrete_distribution<int> pick{ double(cfg_.anon_weight),
+                                          double(cfg_.thp_weight),
+                                          double(cfg_.socket_weight),
+                                          double(cfg_.cache_weight),
+                                          double(cfg_.ptable_weight) };
+
+    int fd = open("/dev/shm", O_TMPFILE | O_RDWR, S_IRUSR | S_IWUSR);
+    if(fd >= 0 && ftruncate(fd, kCacheFileSize) != 0) {
+        close(fd);
+        fd = -1;
+    }
+
+    std::vector<Held> held;
+    held.reserve(cfg_.held);
+
+    const long long period = static_cast<long long>(1e9 / cfg_.ops_per_sec);
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while(running_.load(std::memory_order_relaxed)) {
+        auto kind = static_cast<NoiseKind>(pick(rng));
+        if(kind == NoiseKind::Cache && fd < 0) {
+            kind = NoiseKind::Anon;
+        }
+
+        Held h;
+        if(acquire(kind, rng, cfg_.max_order, fd, h)) {
+            if(held.size() < cfg_.held) {
+                held.push_back(h);
+            } else {
+                auto& victim = held[rng() % held.size()];
+                release(victim, fd);
+                victim = h;
+            }
+            ops_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Absolute deadlines keep the rate steady; a worker that falls
+        // behind runs flat out rather than bursting to catch up.
+        next.tv_nsec += period;
+        next.tv_sec += next.tv_nsec / 1000000000;
+        next.tv_nsec %= 1000000000;
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if(now.tv_sec > next.tv_sec ||
+            (now.tv_sec == next.tv_sec && now.tv_nsec > next.tv_nsec)) {
+            next = now;
+        } else {
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr);
+        }
+    }
+
+    for(const auto& h : held) {
+        release(h, fd);
+    }
+    if(fd >= 0) {
+        close(fd);
+    }
+}
+
+std::vector<int> online_cpus_except(int except) {
+    cpu_set_t set;
+    if(sched_getaffinity(0, sizeof(set), &set) != 0) {
+        throw std::system_error(errno, std::system_category(),
+                                "sched_getaffinity failed");
+    }
+
+    std::vector<int> cpus;
+    for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if(CPU_ISSET(cpu, &set) && cpu != except) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
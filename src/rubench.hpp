@@ -16,11 +16,24 @@
 #define RUBENCH_MAGIC 'R'
 
 #define RUBENCH_GET_BLOCKS \
-_IOR(RUBENCH_MAGIC, 1, struct rubench_get_blocks_data)
+_IOWR(RUBENCH_MAGIC, 1, struct rubench_get_blocks_data)
 #define RUBENCH_VA_TO_PA _IOWR(RUBENCH_MAGIC, 2, struct rubench_va_to_pa_data)
 #define RUBENCH_READ_PHYS _IOWR(RUBENCH_MAGIC, 3, struct rubench_read_phys_data)
+#define RUBENCH_GET_MIGRATETYPES \
+_IOWR(RUBENCH_MAGIC, 4, struct rubench_migratetypes_data)
+#define RUBENCH_WATCH_ARM _IOW(RUBENCH_MAGIC, 5, struct rubench_watch_arm_data)
+#define RUBENCH_WATCH_READ \
+_IOWR(RUBENCH_MAGIC, 6, struct rubench_watch_read_data)
+#define RUBENCH_WATCH_DISARM _IO(RUBENCH_MAGIC, 7)
+// Changes the polling period of an armed watch without restarting it
+#define RUBENCH_WATCH_PERIOD _IOW(RUBENCH_MAGIC, 8, unsigned long)
+
+// Zone index meaning ZONE_NORMAL, whose index depends on the kernel config.
+#define RUBENCH_ZONE_NORMAL (-1)
 
 struct rubench_get_blocks_data {
+    int node;
+    int zone;
     unsigned long num_pages;
 };
 
@@ -34,14 +47,99 @@ struct rubench_read_phys_data {
     unsigned long data;
 };
 
+// Upper bound on pageblocks per RUBENCH_GET_MIGRATETYPES call
+#define RUBENCH_MAX_PAGEBLOCKS 4096
+// Reported for pageblocks without a valid memmap
+#define RUBENCH_MIGRATE_INVALID 0xff
+
+struct rubench_migratetypes_data {
+    unsigned long start_pfn;       // rounded down to a pageblock boundary
+    unsigned long nr_blocks;
+    unsigned long pageblock_pages; // out: pages per pageblock
+    unsigned char* types;          // out: one migratetype per pageblock,
+                                   // written in place; keep it resident
+                                   // so the copy does not fault
+};
+
+#define RUBENCH_MAX_WATCHES 16
+// Capacity of the module's event buffer; further changes are dropped
+#define RUBENCH_WATCH_EVENTS 4096
+
+struct rubench_watch_arm_data {
+    unsigned long pa[RUBENCH_MAX_WATCHES]; // 8-byte aligned
+    unsigned long nr;
+    unsigned long period_ns; // polling period, spins below 20 us
+    int cpu;                 // CPU to pin the poller to, or -1
+};
+
+struct rubench_watch_event {
+    unsigned long pa;
+    unsigned long old_value;
+    unsigned long new_value;
+    long long ktime_ns; // ktime_get(), i.e. CLOCK_MONOTONIC
+    int cpu;            // CPU the poller observed the change on
+};
+
+struct rubench_watch_read_data {
+    struct rubench_watch_event* events;
+    unsigned long max;
+    unsigned long nr;      // out: events copied
+    unsigned long dropped; // out: events lost to a full buffer since arming
+};
+
+// Where rubench_va_to_pa() gets translations that are not cached. Neither
+// backend faults pages in: a page that is not present (never touched, or
+// swapped out) translates to PA 0 and is not cached.
+enum rubench_translation_backend {
+    RUBENCH_TRANSLATE_PAGEMAP, // /proc/self/pagemap, needs CAP_SYS_ADMIN
+    RUBENCH_TRANSLATE_KMOD,    // RUBENCH_VA_TO_PA, works unprivileged
+};
+
+struct rubench_translation_stats {
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long invalidations; // cached pages dropped
+    unsigned long entries;
+};
+
+// Everything above is the ioctl ABI shared with kmod/rubench.c and must
+// stay plain C. The user-space API below is C++ only.
+#ifdef __cplusplus
+
 void rubench_open();
 void rubench_close();
 
-int rubench_get_blocks();
+int rubench_get_blocks(int node = 0, int zone = RUBENCH_ZONE_NORMAL);
 unsigned long rubench_va_to_pa(void* va);
+
+// rubench_va_to_pa() caches per page until the library unmaps or remaps
+// that page. Code that changes mappings behind the library's back must
+// invalidate the range itself. Switching backends clears the cache.
+void rubench_set_translation_backend(enum rubench_translation_backend backend);
+void rubench_invalidate_translation(void* va, unsigned long len);
+struct rubench_translation_stats rubench_get_translation_stats();
 unsigned long rubench_read_phys(unsigned long pa);
+void rubench_watch_arm(const unsigned long* pas,
+                       unsigned long nr,
+                       unsigned long period_ns,
+                       int cpu);
+unsigned long rubench_watch_read(struct rubench_watch_event* events,
+                                 unsigned long max,
+                                 unsigned long* dropped);
+void rubench_watch_disarm();
+// Unlike rubench_watch_arm(), which starts a kernel thread, this does not
+// allocate, so it is safe while a page waits on a PCP list.
+void rubench_watch_set_period(unsigned long period_ns);
+unsigned long rubench_get_migratetypes(unsigned long pfn,
+                                       unsigned long nr_blocks,
+                                       unsigned char* types);
+
+// CLOCK_MONOTONIC in ns, the clock the module's ktime timestamps use
+long long monotonic_ns();
 
 void run_microbenchmark(int num_rounds,
                         void (*pre)(void),
                         void (*func)(void),
-                        int (*post)(void));
\ No newline at end of file
+                        int (*post)(void));
+
+#endif // __cplusplus
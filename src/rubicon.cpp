@@ -7,23 +7,38 @@
  */
 
 #include "rubicon.hpp"
+#include "probes.hpp"
+#include "rubench.hpp"
 
+#include <algorithm>
 #include <cstdint>
 #include <fcntl.h>
+#include <numeric>
+#include <random>
 #include <stdexcept>
 #include <system_error>
 #include <sys/mman.h>
 #include <unistd.h>
+#include <unordered_set>
 #include <vector>
 
 int pcp_evict() {
-    void* flush_ptr = mmap(NULL, PCP_PUSH_SIZE, PROT_READ | PROT_WRITE,
+    const std::size_t push_size = rubicon_config().pcp_push_size;
+    RUBICON_PROBE1(pcp_evict__entry, push_size);
+
+    // The PCP lists are per zone, so the flush has to hit the target node.
+    NodeBinding bind;
+    void* flush_ptr = mmap(NULL, push_size, PROT_READ | PROT_WRITE,
                            MAP_ANONYMOUS | MAP_PRIVATE | MAP_POPULATE, -1, 0);
     if(flush_ptr == MAP_FAILED) {
+        RUBICON_PROBE2(pcp_evict__exit, push_size, -1L);
         return -1;
     }
 
-    return munmap(flush_ptr, PCP_PUSH_SIZE);
+    int rv = munmap(flush_ptr, push_size);
+    rubench_invalidate_translation(flush_ptr, push_size);
+    RUBICON_PROBE2(pcp_evict__exit, push_size, rv);
+    return rv;
 }
 
 bool is_page_aligned(uintptr_t addr) noexcept {
@@ -80,7 +95,76 @@ std::vector<void*> pages_in_span(void* base, std::size_t order) {
     return pages;
 }
 
+std::vector<void*>
+random_pages_in_block(void* block,
+                      std::size_t block_size,
+                      std::size_t count) {
+    if(block_size == 0)
+        throw std::invalid_argument("block_size must be > 0");
+
+    if(block_size % PAGE_SIZE != 0)
+        throw std::invalid_argument(
+            "block_size must be a multiple of PAGE_SIZE");
+
+    const uintptr_t base = reinterpret_cast<uintptr_t>(block);
+    if(!is_page_aligned(base))
+        throw std::invalid_argument("block is not page-aligned");
+
+    std::size_t pages = block_size / PAGE_SIZE;
+
+    if(count == 0 || count > pages)
+        throw std::invalid_argument("requested page count is out of range");
+
+    // Build [0, 1, 2, …, pages-1], shuffle, and take the first ‘count’.
+    static thread_local std::mt19937_64 rng{ std::random_device{}() };
+
+    std::vector<std::size_t> indices(pages);
+    std::iota(indices.begin(), indices.end(), 0);
+    std::shuffle(indices.begin(), indices.end(), rng);
+
+    std::vector<void*> out;
+    out.reserve(count);
+    for(std::size_t i = 0; i < count; ++i)
+        out.emplace_back(
+            reinterpret_cast<void*>(base + indices[i] * PAGE_SIZE));
+
+    return out;
+}
+
+std::size_t
+erase_pages(std::vector<void*>& pages, const std::vector<void*>& victims) {
+    // Fast-path: nothing to do
+    if(victims.empty())
+        return 0;
+
+    // Validate alignment of every victim
+    for(void* p : victims)
+        if(!is_page_aligned(reinterpret_cast<uintptr_t>(p)))
+            throw std::invalid_argument(
+                "erase_pages: address is not page-aligned");
+
+    // Put victims in a hash set for O(1) look-ups
+    std::unordered_set<void*> kill(victims.begin(), victims.end());
+
+    // Stable erase-remove idiom
+    auto new_end = std::remove_if(pages.begin(), pages.end(),
+                                  [&kill](void* p) { return kill.count(p); });
+
+    std::size_t erased = std::distance(new_end, pages.end());
+    pages.erase(new_end, pages.end());
+    return erased;
+}
+
+void* flip_bit(void* addr, unsigned pos) {
+    auto v = reinterpret_cast<uintptr_t>(addr);
+    v ^= (1ULL << pos);
+    return reinterpret_cast<void*>(v);
+}
+
 void map_pages(const std::vector<void*>& pages, int fd) {
+    void* first = pages.empty() ? nullptr : pages.front();
+    RUBICON_PROBE3(map_pages__entry, first, pages.size(), fd);
+
     for(void* page : pages) {
         if(!is_page_aligned(reinterpret_cast<uintptr_t>(page))) {
             throw std::invalid_argument(
@@ -96,10 +180,16 @@ void map_pages(const std::vector<void*>& pages, int fd) {
             throw std::system_error(errno, std::system_category(),
                                     "mmap failed");
         }
+        rubench_invalidate_translation(page, PAGE_SIZE);
     }
+
+    RUBICON_PROBE3(map_pages__exit, first, pages.size(), fd);
 }
 
 void unmap_pages(const std::vector<void*>& pages) {
+    void* first = pages.empty() ? nullptr : pages.front();
+    RUBICON_PROBE2(unmap_pages__entry, first, pages.size());
+
     for(void* p : pages) {
         if(!is_page_aligned(reinterpret_cast<uintptr_t>(p))) {
             throw std::invalid_argument(
@@ -110,18 +200,33 @@ void unmap_pages(const std::vector<void*>& pages) {
             throw std::system_error(errno, std::system_category(),
                                     "munmap failed");
         }
+        rubench_invalidate_translation(p, PAGE_SIZE);
     }
+
+    RUBICON_PROBE2(unmap_pages__exit, first, pages.size());
 }
 
 void block_merge(void* target, unsigned order) {
+    RUBICON_PROBE3(block_merge__entry, target, order, PAGE_SIZE << order);
+
     auto pages = pages_in_span(target, order);
     unmap_pages(pages);
 
     if(order != 0) {
         pcp_evict();
     }
+
+    RUBICON_PROBE3(block_merge__exit, target, order, PAGE_SIZE << order);
 }
 
 unsigned long exhaust_pages_size_bytes() {
-    return sysconf(_SC_AVPHYS_PAGES) * sysconf(_SC_PAGESIZE) - 0x10000000UL;
+    const unsigned long free_bytes = node_free_bytes(target_node());
+    const unsigned long margin     = rubicon_config().exhaust_margin;
+
+    // Nothing left to exhaust; the round runs against the bait alone.
+    if(free_bytes <= margin) {
+        return 0;
+    }
+
+    return (free_bytes - margin) & ~(PAGE_SIZE - 1);
 }
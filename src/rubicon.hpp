@@ -2,22 +2,123 @@
 
 #include <cstdint>
 #include <cstdio>
+#include <functional>
 #include <vector>
 
 #define PAGE_SIZE 0x1000UL
 #define PCP_PUSH_SIZE 0x2000000UL
+#define ZONE_RESERVE 0xc0000000UL
 
 // Size of the virtual-address range covered by one x86-64 4 KiB page table
 inline constexpr std::size_t kX86_64PageTableSpan = 1ULL << 21; // 2 MiB
 inline constexpr std::size_t kPageBlockSize = 1ULL << 21; // 2 MiB
+// Free memory the exhaust mapping deliberately leaves behind
+inline constexpr std::size_t kExhaustMargin = 0x10000000UL; // 256 MiB
+// Smallest zone_reserve/exhaust_margin; below it the drain and exhaust push
+// the node into its watermarks and reclaim or the OOM killer take over.
+inline constexpr std::size_t kMinReserve = 0x4000000UL; // 64 MiB
 
+// Run-time tunables; the defaults are the values that used to be
+// hardcoded across the library and test_mtype_escalate.
+struct RubiconConfig {
+    std::size_t spray_cover_bytes = kExhaustMargin + (1ULL << 10) * PAGE_SIZE;
+    std::size_t bait_count        = 1ULL << 10;
+    std::size_t sample_pages      = 100;
+    std::size_t pcp_push_size     = PCP_PUSH_SIZE;
+    std::size_t zone_reserve      = ZONE_RESERVE;
+    std::size_t exhaust_margin    = kExhaustMargin;
+};
+
+struct ConfigField {
+    const char* name;
+    std::size_t RubiconConfig::*member;
+};
+
+// All tunables, in declaration order.
+const std::vector<ConfigField>& config_fields();
+
+const RubiconConfig& rubicon_config() noexcept;
+// Throws std::invalid_argument for out-of-range fields. The reserves are
+// checked against the target node, so call set_target_node() first.
+void set_rubicon_config(const RubiconConfig& cfg);
+
+// One "name = value" per line; '#' starts a comment. Values are decimal,
+// 0x hex or 0 octal. Unset fields keep their defaults; unknown names and
+// lines that do not parse throw std::invalid_argument.
+RubiconConfig load_config(const char* path);
+void write_config(FILE* out, const RubiconConfig& cfg);
+
+// Page-table spray owned across pt_install() rounds. Slot i is a single
+// page at base + i * kX86_64PageTableSpan, so every armed slot owns one
+// page table. pt_install() frees the tail every round so the next spray
+// allocates fresh page tables; only slot 0 stays live in between, and
+// arm() skips it. Live runs are released with one munmap each.
+class SprayPool {
+public:
+    // Enough slots to cover cover_bytes of free memory with page tables.
+    SprayPool(void* base, std::size_t cover_bytes);
+    ~SprayPool();
+
+    SprayPool(const SprayPool&)            = delete;
+    SprayPool& operator=(const SprayPool&) = delete;
+
+    static std::size_t slots_for(std::size_t cover_bytes) noexcept;
+
+    std::size_t capacity() const noexcept {
+        return live_.size();
+    }
+    std::size_t live() const noexcept {
+        return live_count_;
+    }
+    void* slot(std::size_t i) const;
+
+    // Maps the dead slots among [0, count) to page 0 of fd.
+    void arm(std::size_t count, int fd);
+    // Unmaps the live slots among [first, last).
+    void release(std::size_t first, std::size_t last);
+
+private:
+    uintptr_t base_;
+    std::vector<bool> live_;
+    std::size_t live_count_ = 0; // kept so probe arguments stay O(1)
+};
+
+// Points in pt_install() after which the round can be checked.
+enum class InstallStage {
+    BaitFreed,   // bait pages released and the PCP flushed
+    TargetFreed, // pt_target unmapped, expected on a PCP list
+    Installed,   // addr mapped, expected to use pt_target as its page table
+};
+
+const char* install_stage_name(InstallStage stage) noexcept;
+
+// Called after each stage; returning false aborts the round.
+using StageCheck = std::function<bool(InstallStage)>;
+
+// Returns MAP_FAILED, with nothing mapped at addr, if check aborts a round.
 void* pt_install(const std::vector<void*>& bait_pages, void* pt_target, void* addr,
-                 const std::vector<void*>& spray_pages, int fd_spray);
+                 SprayPool& spray, int fd_spray,
+                 const StageCheck& check = {});
+
+// monotonic_ns() taken right before the last pt_install()'s final mmap, or
+// 0 if that call aborted before reaching it.
+long long pt_install_map_ns() noexcept;
+
+// One silent acquisition and installation round as test_mtype_escalate
+// runs it, using rubicon_config(). Leaves nothing mapped behind.
+bool install_round(SprayPool& spray, void* block_base);
 
+// Free memory on the target node beyond exhaust_margin, 0 if there is none.
 unsigned long exhaust_pages_size_bytes();
 void* get_4mb_block(void* address);
 
 bool is_page_aligned(uintptr_t addr) noexcept;
+std::vector<void*> random_pages_in_block(void* block,
+                                         std::size_t block_size,
+                                         std::size_t count);
+std::size_t erase_pages(std::vector<void*>& pages,
+                        const std::vector<void*>& victims);
+void* flip_bit(void* addr, unsigned pos);
 std::vector<void*> pages_in_span(void* base, std::size_t order);
 void map_pages(const std::vector<void*>& pages, int fd);
 void unmap_pages(const std::vector<void*>& pages);
@@ -28,3 +129,31 @@ std::vector<void*> strided_addresses(void* base,
 int pcp_evict();
 
 void block_merge(void* target, unsigned order);
+
+// NUMA node the drain, exhaust, spray and evict mappings are bound to and
+// sized from. -1 (the default) leaves placement to the kernel.
+void set_target_node(int node);
+int target_node() noexcept;
+unsigned long node_free_bytes(int node);
+unsigned long node_total_bytes(int node);
+
+// Binds the calling thread's allocations to one node for the lifetime of
+// the guard and restores the previous memory policy afterwards.
+class NodeBinding {
+public:
+    static constexpr std::size_t kBitsPerWord = 8 * sizeof(unsigned long);
+    static constexpr std::size_t kMaxNodes    = 1024;
+    static constexpr std::size_t kMaskWords   = kMaxNodes / kBitsPerWord;
+
+    NodeBinding();
+    explicit NodeBinding(int node);
+    ~NodeBinding();
+
+    NodeBinding(const NodeBinding&)            = delete;
+    NodeBinding& operator=(const NodeBinding&) = delete;
+
+private:
+    bool active_  = false;
+    int old_mode_ = 0;
+    unsigned long old_mask_[kMaskWords] = {};
+};
@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2025 Matej Bölcskei, ETH Zurich
+ * Licensed under the GNU General Public License as published by the Free Software Foundation, version 3.
+ * See LICENSE or <https://www.gnu.org/licenses/gpl-3.0.html> for details.
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+// Searches the RubiconConfig space for the configuration with the most
+// successful page-table installs per second on this host.
+//
+//   sweep_config [grid|halving] [rounds] [node] [seed] > best.conf
+//
+// grid runs every candidate for `rounds` rounds. halving (successive
+// halving) starts every candidate with `rounds` rounds, keeps the best
+// third and triples their rounds until one is left. Progress goes to
+// stderr; the winner is written to stdout in load_config() format.
+
+#include "rubench.hpp"
+#include "rubicon.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+struct SweepAxis {
+    std::size_t RubiconConfig::*member;
+    std::vector<std::size_t> values;
+};
+
+static const std::vector<SweepAxis> kAxes = {
+    { &RubiconConfig::spray_cover_bytes,
+      { 0x8000000UL, 0x10400000UL, 0x20000000UL } },
+    { &RubiconConfig::bait_count, { 256, 512, 1024 } },
+    { &RubiconConfig::sample_pages, { 2, 16, 100 } },
+    { &RubiconConfig::pcp_push_size,
+      { 0x1000000UL, 0x2000000UL, 0x4000000UL } },
+    { &RubiconConfig::zone_reserve, { 0x40000000UL, 0xc0000000UL } },
+    { &RubiconConfig::exhaust_margin,
+      { 0x8000000UL, 0x10000000UL, 0x20000000UL } },
+};
+
+struct Candidate {
+    RubiconConfig cfg;
+    std::size_t rounds    = 0;
+    std::size_t successes = 0;
+    long long ns          = 0;
+};
+
+static void* const kBlockBase = (void*)0x100000000UL;
+static void* const kSprayBase = (void*)0x200000000UL;
+
+static void evaluate(Candidate& c, std::size_t rounds) {
+    set_rubicon_config(c.cfg);
+    SprayPool spray(kSprayBase, c.cfg.spray_cover_bytes);
+
+    for(std::size_t r = 0; r < rounds; ++r) {
+        const long long start = monotonic_ns();
+        c.successes += install_round(spray, kBlockBase);
+        c.ns += monotonic_ns() - start;
+        c.rounds++;
+    }
+}
+
+static double throughput(const Candidate& c) {
+    return c.ns ? c.successes / (c.ns * 1e-9) : 0.0;
+}
+
+// 95% Wilson interval on the success rate, scaled by the round rate.
+static void throughput_bounds(const Candidate& c, double& lo, double& hi) {
+    lo = hi = 0.0;
+    if(c.rounds == 0 || c.ns == 0) {
+        return;
+    }
+
+    const double z      = 1.96;
+    const double n      = c.rounds;
+    const double p      = c.successes / n;
+    const double centre = (p + z * z / (2 * n)) / (1 + z * z / n);
+    const double half   = z / (1 + z * z / n) *
+        std::sqrt(p * (1 - p) / n + z * z / (4 * n * n));
+    const double rate   = n / (c.ns * 1e-9);
+
+    lo = std::max(0.0, centre - half) * rate;
+    hi = std::min(1.0, centre + half) * rate;
+}
+
+static void report(FILE* out, const char* prefix, const Candidate& c) {
+    double lo, hi;
+    throughput_bounds(c, lo, hi);
+    fprintf(out, "%s%zu/%zu ok, %.4f installs/s [%.4f, %.4f]:", prefix,
+            c.successes, c.rounds, throughput(c), lo, hi);
+    for(const auto& field : config_fields()) {
+        fprintf(out, " %s=%zu", field.name, c.cfg.*field.member);
+    }
+    fprintf(out, "\n");
+}
+
+static std::vector<Candidate> grid_candidates() {
+    std::vector<Candidate> out(1);
+    for(const auto& axis : kAxes) {
+        std::vector<Candidate> next;
+        for(const auto& c : out) {
+            for(std::size_t v : axis.values) {
+                Candidate n        = c;
+                n.cfg.*axis.member = v;
+                next.push_back(n);
+            }
+        }
+        out = std::move(next);
+    }
+    return out;
+}
+
+// Drops candidates set_rubicon_config() rejects on this host, e.g. a
+// zone_reserve larger than the node.
+static void drop_invalid(std::vector<Candidate>& candidates) {
+    const auto invalid = [](const Candidate& c) {
+        try {
+            set_rubicon_config(c.cfg);
+            return false;
+        } catch(const std::invalid_argument&) {
+            return true;
+        }
+    };
+
+    const std::size_t before = candidates.size();
+    candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                                    invalid),
+                     candidates.end());
+    if(candidates.size() != before) {
+        fprintf(stderr, "Skipping %zu candidates invalid on this node\n",
+                before - candidates.size());
+    }
+}
+
+static bool by_throughput(const Candidate& a, const Candidate& b) {
+    return throughput(a) > throughput(b);
+}
+
+int main(int argc, char** argv) {
+    const bool halving       = argc > 1 && strcmp(argv[1], "halving") == 0;
+    const std::size_t rounds = argc > 2 ? std::atoi(argv[2]) : 1;
+    set_target_node(argc > 3 ? std::atoi(argv[3]) : 0);
+    const unsigned seed = argc > 4 ? std::atoi(argv[4]) : 0;
+
+    rubench_open();
+
+    auto candidates = grid_candidates();
+    drop_invalid(candidates);
+    if(candidates.empty()) {
+        fprintf(stderr, "No candidate fits node %d\n", target_node());
+        return 1;
+    }
+    std::shuffle(candidates.begin(), candidates.end(), std::mt19937(seed));
+
+    std::size_t budget = std::max<std::size_t>(rounds, 1);
+    do {
+        fprintf(stderr, "Evaluating %zu candidates, %zu rounds each\n",
+                candidates.size(), budget);
+        for(auto& c : candidates) {
+            evaluate(c, budget - c.rounds);
+            report(stderr, "  ", c);
+        }
+
+        std::stable_sort(candidates.begin(), candidates.end(),
+                         by_throughput);
+        if(halving) {
+            candidates.resize((candidates.size() + 2) / 3);
+            budget *= 3;
+        }
+    } while(halving && candidates.size() > 1);
+
+    const Candidate& best = candidates.front();
+    report(stderr, "Best: ", best);
+
+    double lo, hi;
+    throughput_bounds(best, lo, hi);
+    printf("# %zu/%zu rounds ok, %.4f installs/s, 95%% CI [%.4f, %.4f]\n",
+           best.successes, best.rounds, throughput(best), lo, hi);
+    write_config(stdout, best.cfg);
+
+    rubench_close();
+    return 0;
+}
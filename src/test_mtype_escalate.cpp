@@ -6,89 +6,25 @@
  * SPDX-License-Identifier: GPL-3.0-only
  */
 
+#include "migratetype.hpp"
+#include "noise.hpp"
 #include "rubench.hpp"
 #include "rubicon.hpp"
+#include "verify.hpp"
 
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <fcntl.h>
+#include <sched.h>
 #include <unistd.h>
 #include <sys/mman.h>
-#include <unordered_set>
-#include <random>
-#include <stdexcept>
 #include <cstdint>   // uintptr_t
 #include <vector>
-#include <algorithm>    // std::find
 #include <iomanip>
 #include <ios>
 #include <iostream>
 
-inline std::vector<void*>
-random_pages_in_block(void* block,
-                      std::size_t block_size,
-                      std::size_t count) {
-    if(block_size == 0)
-        throw std::invalid_argument("block_size must be > 0");
-
-    if(block_size % PAGE_SIZE != 0)
-        throw std::invalid_argument(
-            "block_size must be a multiple of PAGE_SIZE");
-
-    const uintptr_t base = reinterpret_cast<uintptr_t>(block);
-    if(!is_page_aligned(base))
-        throw std::invalid_argument("block is not page-aligned");
-
-    std::size_t pages = block_size / PAGE_SIZE;
-
-    if(count == 0 || count > pages)
-        throw std::invalid_argument("requested page count is out of range");
-
-    // Build [0, 1, 2, …, pages-1], shuffle, and take the first ‘count’.
-    static thread_local std::mt19937_64 rng{ std::random_device{}() };
-
-    std::vector<std::size_t> indices(pages);
-    std::iota(indices.begin(), indices.end(), 0);
-    std::shuffle(indices.begin(), indices.end(), rng);
-
-    std::vector<void*> out;
-    out.reserve(count);
-    for(std::size_t i = 0; i < count; ++i)
-        out.emplace_back(
-            reinterpret_cast<void*>(base + indices[i] * PAGE_SIZE));
-
-    return out;
-}
-
-inline std::size_t
-erase_pages(std::vector<void*>& pages, const std::vector<void*>& victims) {
-    // Fast-path: nothing to do
-    if(victims.empty())
-        return 0;
-
-    // Validate alignment of every victim
-    for(void* p : victims)
-        if(!is_page_aligned(reinterpret_cast<uintptr_t>(p)))
-            throw std::invalid_argument(
-                "erase_pages: address is not page-aligned");
-
-    // Put victims in a hash set for O(1) look-ups
-    std::unordered_set<void*> kill(victims.begin(), victims.end());
-
-    // Stable erase-remove idiom
-    auto new_end = std::remove_if(pages.begin(), pages.end(),
-                                  [&kill](void* p) { return kill.count(p); });
-
-    std::size_t erased = std::distance(new_end, pages.end());
-    pages.erase(new_end, pages.end());
-    return erased;
-}
-
-void* flip_bit(void* addr, unsigned pos) {
-    auto v = reinterpret_cast<uintptr_t>(addr);
-    v ^= (1ULL << pos);
-    return reinterpret_cast<void*>(v);
-}
-
 inline void print_ptr_hex(const char* label, void* ptr) {
     std::ios old_state(nullptr);
     old_state.copyfmt(std::cout); // save caller’s formatting
@@ -102,30 +38,63 @@ inline void print_ptr_hex(const char* label, void* ptr) {
     std::cout.copyfmt(old_state); // restore formatting
 }
 
-int main() {
+int main(int argc, char** argv) {
+    // Optional NUMA node to run on; node 0 exists on every host.
+    set_target_node(argc > 1 ? std::atoi(argv[1]) : 0);
+    // Optional configuration, e.g. the output of sweep_config.
+    if(argc > 2) {
+        set_rubicon_config(load_config(argv[2]));
+    }
+    const RubiconConfig& cfg = rubicon_config();
+
+    // pt_install() relies on the per-CPU PCP list of the CPU it runs on, so
+    // the test stays on one CPU and the target watch polls from another.
+    const int test_cpu    = sched_getcpu();
+    const auto other_cpus = online_cpus_except(test_cpu);
+    const int watch_cpu   = other_cpus.empty() ? -1 : other_cpus.front();
+    // With no CPU to spare the poller sleeps between reads instead of
+    // spinning next to the test.
+    const unsigned long watch_period_ns = watch_cpu < 0 ? 20000 : 1000;
+    // Period while the exhaust and spray run; the poller sleeps.
+    const unsigned long watch_idle_ns = 1000000;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(test_cpu, &set);
+    sched_setaffinity(0, sizeof(set), &set);
+
     rubench_open();
+    // Optional "kmod" to translate through the module instead of pagemap.
+    if(argc > 3 && strcmp(argv[3], "kmod") == 0) {
+        rubench_set_translation_backend(RUBENCH_TRANSLATE_KMOD);
+    }
 
     void* page_block_base = (void*)0x100000000UL;
     void* spray_base = (void*)0x200000000UL;
-    constexpr uint64_t spray_pt_count = 65000UL;
-    auto spray = strided_addresses(spray_base, spray_pt_count,
-                                   kX86_64PageTableSpan);
+    SprayPool spray(spray_base, cfg.spray_cover_bytes);
+    StageVerifier verifier;
 
-    int num_rounds       = 100;
-    long long total_time = 0;
-    int num_fails        = 0;
+    int num_rounds            = 100;
+    long long total_time      = 0;
+    int num_fails             = 0;
+    int num_escalated         = 0;
+    long long escalation_time = 0;
+    int num_landed            = 0;
+    long long landing_time    = 0;
 
     for(int round = 0; round < num_rounds; round++) {
         printf("Round %d\n", round);
-        std::cout << "spray size : " << spray.size() << '\n'
+        std::cout << "spray size : " << spray.capacity() << '\n'
+            << "spray live : " << spray.live() << '\n'
             << "last addr  : 0x"
             << std::hex << std::uppercase
-            << reinterpret_cast<std::uintptr_t>(spray.back())
+            << reinterpret_cast<std::uintptr_t>(
+                spray.slot(spray.capacity() - 1))
             << std::dec << '\n';
 
         page_block_base   = get_4mb_block(page_block_base);
         auto random_pages = random_pages_in_block(
-            page_block_base, 2 * kPageBlockSize, 100);
+            page_block_base, 2 * kPageBlockSize, cfg.sample_pages);
         void* pt_target = random_pages[0];
         mlock((void*)(unsigned long)pt_target, PAGE_SIZE);
         unsigned long target_phys = rubench_va_to_pa(pt_target);
@@ -139,29 +108,96 @@ int main() {
         const char* buf = "ffffffffffffffff";
         auto fd = open("/dev/shm", O_TMPFILE | O_RDWR, S_IRUSR | S_IWUSR);
         munmap(file_target, PAGE_SIZE);
+        rubench_invalidate_translation(file_target, PAGE_SIZE);
         write(fd, buf, 8);
         auto fd_ptr = mmap(file_target, PAGE_SIZE, PROT_READ | PROT_WRITE,
                            MAP_SHARED | MAP_POPULATE, fd, 0);
         mlock(fd_ptr, PAGE_SIZE);
 
-        auto addr       = (void*)(spray_base + kPageBlockSize);
-        auto bait_pages = strided_addresses(page_block_base, 1ULL << 10,
+        auto addr       = spray.slot(1);
+        auto bait_pages = strided_addresses(page_block_base, cfg.bait_count,
                                             PAGE_SIZE);
         erase_pages(bait_pages, random_pages);
-        pt_install(bait_pages, pt_target, addr, spray, fd);
 
-        unsigned long value = rubench_read_phys(target_phys);
-        auto file_phys      = rubench_va_to_pa(fd_ptr);
+        auto block_pfn = rubench_va_to_pa(page_block_base) / PAGE_SIZE;
+        auto verify    = verifier.install_check(page_pfns(bait_pages),
+                                                target_phys / PAGE_SIZE);
+
+        // get_4mb_block() spans two pageblocks.
+        MigratetypeTracker mtypes(block_pfn, 2);
+
+        // Watch the PTE slot that the install should write, timed from
+        // right before pt_install()'s final mmap. Arming starts a kernel
+        // thread, which allocates, so it happens here with a sleeping
+        // poller; TargetFreed only switches it to its fast period.
+        rubench_watch_arm(&target_phys, 1, watch_idle_ns, watch_cpu);
+
+        InstallStage stage{};
+        // pt_target is on the PCP list between TargetFreed and the final
+        // mmap; anything that allocates there can take it, so that stage
+        // only runs the allocation-free verifier and period switch.
+        auto check = [&](InstallStage s) {
+            stage = s;
+            if(s == InstallStage::TargetFreed) {
+                rubench_watch_set_period(watch_period_ns);
+            } else {
+                mtypes.sample(install_stage_name(s));
+            }
+            return verify(s);
+        };
+
+        const bool installed =
+            pt_install(bait_pages, pt_target, addr, spray, fd, check) !=
+            MAP_FAILED;
+        if(!installed) {
+            printf("ABORT after %s\n", install_stage_name(stage));
+        } else {
+            unsigned long value = rubench_read_phys(target_phys);
+            auto file_phys      = rubench_va_to_pa(fd_ptr);
+
+            printf("Pageblock physical address: %lx\n", target_phys);
+            printf("File physical address: %lx\n", file_phys);
+            printf("Value read from target: %lx\n", value);
+            auto success = (value & 0xFFFFFFFFF000) == file_phys;
+
+            if(success) {
+                printf("PASS\n");
+            } else {
+                printf("FAIL\n");
+            }
+        }
 
-        printf("Pageblock physical address: %lx\n", target_phys);
-        printf("File physical address: %lx\n", file_phys);
-        printf("Value read from target: %lx\n", value);
-        auto success = (value & 0xFFFFFFFFF000) == file_phys;
+        rubench_watch_disarm();
+        const long long install_ns = pt_install_map_ns();
+        rubench_watch_event events[64];
+        unsigned long dropped;
+        unsigned long nr_events = rubench_watch_read(events, 64, &dropped);
+        bool landed             = false;
+        for(unsigned long i = 0; i < nr_events; i++) {
+            const auto& e = events[i];
+            printf("Target %lx: %lx -> %lx at %+lld ns on CPU %d\n", e.pa,
+                   e.old_value, e.new_value, e.ktime_ns - install_ns, e.cpu);
+
+            if(installed && !landed && install_ns &&
+                (e.new_value & 0xFFFFFFFFF000) == rubench_va_to_pa(fd_ptr)) {
+                landed = true;
+                num_landed++;
+                landing_time += e.ktime_ns - install_ns;
+            }
+        }
+        if(dropped) {
+            printf("Target watch dropped %lu events\n", dropped);
+        }
 
-        if(success) {
-            printf("PASS\n");
-        } else {
-            printf("FAIL\n");
+        for(const auto& c : mtypes.changes()) {
+            printf("Pageblock %lx: %s -> %s after %s (+%lld ns, window %lld "
+                   "ns)\n",
+                   c.pfn, migratetype_name(c.from), migratetype_name(c.to),
+                   c.stage, c.since_start_ns, c.window_ns);
+        }
+        if(!mtypes.changes().empty()) {
+            num_escalated++;
+            escalation_time += mtypes.changes().front().since_start_ns;
         }
 
         close(fd);
@@ -170,8 +206,33 @@ int main() {
 
         munmap(addr, PAGE_SIZE);
         munmap(page_block_base, kPageBlockSize);
+        rubench_invalidate_translation(page_block_base, 2 * kPageBlockSize);
+    }
+
+    for(auto stage : { InstallStage::BaitFreed, InstallStage::TargetFreed,
+                       InstallStage::Installed }) {
+        printf("Stage %s: %zu/%zu checks failed\n",
+               install_stage_name(stage), verifier.failures(stage),
+               verifier.checks(stage));
+    }
+
+    printf("Rounds with a migratetype change: %d/%d\n", num_escalated,
+           num_rounds);
+    if(num_escalated) {
+        printf("Average time to first change: %lld ns\n",
+               escalation_time / num_escalated);
+    }
+
+    if(num_landed) {
+        printf("Average PTE landing latency: %lld ns over %d rounds\n",
+               landing_time / num_landed, num_landed);
     }
 
+    auto tstats = rubench_get_translation_stats();
+    printf("Translation cache: %lu hits, %lu misses, %lu invalidated, %lu "
+           "cached\n",
+           tstats.hits, tstats.misses, tstats.invalidations, tstats.entries);
+
     printf("Number of failed tests: %d\n", num_fails);
     printf("Average time taken: %lld ns\n",
            total_time / (num_rounds - num_fails));
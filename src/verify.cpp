@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2025 Matej Bölcskei, ETH Zurich
+ * Licensed under the GNU General Public License as published by the Free Software Foundation, version 3.
+ * See LICENSE or <https://www.gnu.org/licenses/gpl-3.0.html> for details.
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include "verify.hpp"
+#include "pagemap.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <linux/kernel-page-flags.h>
+#include <system_error>
+#include <unistd.h>
+#include <utility>
+
+// Flags that mean the page is owned by someone, i.e. not on a free list.
+static constexpr uint64_t kInUseFlags =
+    (1ULL << KPF_LRU) | (1ULL << KPF_SLAB) | (1ULL << KPF_MMAP) |
+    (1ULL << KPF_ANON) | (1ULL << KPF_COMPOUND_HEAD) |
+    (1ULL << KPF_COMPOUND_TAIL) | (1ULL << KPF_PGTABLE) |
+    (1ULL << KPF_NOPAGE);
+
+static bool page_is_free(uint64_t flags, uint64_t count) {
+    return count == 0 && (flags & kInUseFlags) == 0;
+}
+
+static int open_or_throw(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        throw std::system_error(errno, std::system_category(), path);
+    }
+    return fd;
+}
+
+StageVerifier::StageVerifier(bool abort_on_fail)
+    : abort_on_fail_(abort_on_fail),
+      flags_fd_(open_or_throw("/proc/kpageflags")),
+      count_fd_(-1) {
+    flags_buf_.reserve(kBufferPages);
+    counts_buf_.reserve(kBufferPages);
+
+    try {
+        count_fd_ = open_or_throw("/proc/kpagecount");
+    } catch(...) {
+        close(flags_fd_);
+        throw;
+    }
+}
+
+StageVerifier::~StageVerifier() {
+    close(count_fd_);
+    close(flags_fd_);
+}
+
+const std::vector<uint64_t>& StageVerifier::read_range(
+    int fd, unsigned long pfn, std::size_t count, std::vector<uint64_t>& buf) {
+    buf.resize(count);
+    const std::size_t len = count * sizeof(uint64_t);
+
+    ssize_t n = pread(fd, buf.data(), len, pfn * sizeof(uint64_t));
+    if(n != static_cast<ssize_t>(len)) {
+        throw std::system_error(n < 0 ? errno : EIO, std::system_category(),
+                                "pread of page info failed");
+    }
+
+    return buf;
+}
+
+const std::vector<uint64_t>& StageVerifier::page_flags(unsigned long pfn,
+                                                       std::size_t count) {
+    return read_range(flags_fd_, pfn, count, flags_buf_);
+}
+
+const std::vector<uint64_t>& StageVerifier::page_counts(unsigned long pfn,
+                                                        std::size_t count) {
+    return read_range(count_fd_, pfn, count, counts_buf_);
+}
+
+bool StageVerifier::pages_free(const std::vector<unsigned long>& pfns) {
+    if(pfns.empty()) {
+        return true;
+    }
+
+    // Callers pass pages of one block, so a single window covers them all.
+    const auto [lo, hi] = std::minmax_element(pfns.begin(), pfns.end());
+    const std::size_t span = *hi - *lo + 1;
+    const auto& flags  = page_flags(*lo, span);
+    const auto& counts = page_counts(*lo, span);
+
+    return std::all_of(pfns.begin(), pfns.end(), [&](unsigned long pfn) {
+        const std::size_t i = pfn - *lo;
+        return page_is_free(flags[i], counts[i]);
+    });
+}
+
+bool StageVerifier::on_pcp(unsigned long pfn) {
+    const uint64_t flags = page_flags(pfn, 1)[0];
+    const uint64_t count = page_counts(pfn, 1)[0];
+    return page_is_free(flags, count) && !(flags & (1ULL << KPF_BUDDY));
+}
+
+bool StageVerifier::is_page_table(unsigned long pfn) {
+    return page_flags(pfn, 1)[0] & (1ULL << KPF_PGTABLE);
+}
+
+bool StageVerifier::record(InstallStage stage, bool ok) noexcept {
+    const auto i = static_cast<std::size_t>(stage);
+    ++checks_[i];
+    if(!ok) {
+        ++failures_[i];
+    }
+    return ok || !abort_on_fail_;
+}
+
+StageCheck StageVerifier::install_check(std::vector<unsigned long> bait_pfns,
+                                        unsigned long target_pfn) {
+    return [this, bait = std::move(bait_pfns), target_pfn](InstallStage s) {
+        switch(s) {
+        case InstallStage::BaitFreed: return record(s, pages_free(bait));
+        case InstallStage::TargetFreed: return record(s, on_pcp(target_pfn));
+        case InstallStage::Installed:
+            return record(s, is_page_table(target_pfn));
+        }
+        return true;
+    };
+}
+
+std::size_t StageVerifier::checks(InstallStage stage) const noexcept {
+    return checks_[static_cast<std::size_t>(stage)];
+}
+
+std::size_t StageVerifier::failures(InstallStage stage) const noexcept {
+    return failures_[static_cast<std::size_t>(stage)];
+}
+
+std::vector<unsigned long> page_pfns(const std::vector<void*>& pages) {
+    if(pages.empty()) {
+        return {};
+    }
+
+    // A block that is only contiguous at its ends must not be extrapolated
+    // from its first PFN, so every page is looked up.
+    const auto [lo, hi] = std::minmax_element(pages.begin(), pages.end());
+    const auto first    = reinterpret_cast<uintptr_t>(*lo) & ~(PAGE_SIZE - 1);
+    const std::size_t span =
+        (reinterpret_cast<uintptr_t>(*hi) - first) / PAGE_SIZE + 1;
+
+    std::vector<uint64_t> entries(span);
+    if(!vaddr2pfns(first, span, entries.data())) {
+        throw std::system_error(errno, std::system_category(),
+                                "pread of pagemap failed");
+    }
+
+    std::vector<unsigned long> pfns;
+    pfns.reserve(pages.size());
+    for(void* p : pages) {
+        pfns.emplace_back(
+            entries[(reinterpret_cast<uintptr_t>(p) - first) / PAGE_SIZE]);
+    }
+    return pfns;
+}
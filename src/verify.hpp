@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2025 Matej Bölcskei, ETH Zurich
+ * Licensed under the GNU General Public License as published by the Free Software Foundation, version 3.
+ * See LICENSE or <https://www.gnu.org/licenses/gpl-3.0.html> for details.
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include "rubicon.hpp"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Checks physical pages against what each stage of a round expects, using
+// batched reads of /proc/kpageflags and /proc/kpagecount (root only).
+//
+// kpageflags only marks the head of a free buddy block, so a free page is
+// recognised by having no mappings and no in-use flags. That cannot tell a
+// PCP page from the tail of a buddy block; on_pcp() is therefore a cheap
+// filter that rejects clearly doomed rounds, not a proof of success.
+class StageVerifier {
+public:
+    // With abort_on_fail == false failures are only counted and the
+    // StageCheck returned by install_check() never aborts.
+    explicit StageVerifier(bool abort_on_fail = true);
+    ~StageVerifier();
+
+    StageVerifier(const StageVerifier&)            = delete;
+    StageVerifier& operator=(const StageVerifier&) = delete;
+
+    // One pread per file for the whole range [pfn, pfn + count), into a
+    // buffer that stays valid until the next call. Ranges up to kBufferPages
+    // never allocate, so checks can run while pt_target sits on a PCP list.
+    const std::vector<uint64_t>& page_flags(unsigned long pfn,
+                                            std::size_t count);
+    const std::vector<uint64_t>& page_counts(unsigned long pfn,
+                                             std::size_t count);
+
+    bool pages_free(const std::vector<unsigned long>& pfns);
+    bool on_pcp(unsigned long pfn);
+    bool is_page_table(unsigned long pfn);
+
+    // Stage check for pt_install(): the bait pages must be free after
+    // BaitFreed, pt_target must sit on a PCP list after TargetFreed and
+    // must hold a page table after Installed.
+    StageCheck install_check(std::vector<unsigned long> bait_pfns,
+                             unsigned long target_pfn);
+
+    std::size_t checks(InstallStage stage) const noexcept;
+    std::size_t failures(InstallStage stage) const noexcept;
+
+private:
+    static constexpr std::size_t kStages = 3;
+    // get_4mb_block() spans two pageblocks.
+    static constexpr std::size_t kBufferPages = 2 * kPageBlockSize / PAGE_SIZE;
+
+    const std::vector<uint64_t>& read_range(int fd,
+                                            unsigned long pfn,
+                                            std::size_t count,
+                                            std::vector<uint64_t>& buf);
+    bool record(InstallStage stage, bool ok) noexcept;
+
+    bool abort_on_fail_;
+    int flags_fd_;
+    int count_fd_;
+    std::vector<uint64_t> flags_buf_;
+    std::vector<uint64_t> counts_buf_;
+    std::array<std::size_t, kStages> checks_   = {};
+    std::array<std::size_t, kStages> failures_ = {};
+};
+
+// PFN of the page behind each of pages, read from pagemap with one pread
+// over the range the pages span (root only). Pass pages of one block.
+std::vector<unsigned long> page_pfns(const std::vector<void*>& pages);